@@ -0,0 +1,268 @@
+#include "buddy.h"
+#include "procfs.h"
+#include "library/lib.h"
+
+
+
+/*
+ *  The physical page frame allocator.
+ *  Usable memory from the multiboot memory map is cut into blocks of 2^order
+ *  pages, every block is aligned to its own size. Memory above 8 MB is not
+ *  mapped into the kernel, so all the bookkeeping lives in the arrays below
+ *  instead of inside the free pages. The page frame number is the index.
+ */
+static uint8_t page_state[BUDDY_PAGES];         // see BUDDY_NONE / BUDDY_ALLOCATED
+static int32_t page_next[BUDDY_PAGES];          // free list links of the first page of a free block
+static int32_t page_prev[BUDDY_PAGES];
+static int32_t free_head[BUDDY_MAX_ORDER + 1];  // the first free block of each order, -1 if none
+static int32_t free_count[BUDDY_MAX_ORDER + 1];
+static int32_t total_pages = 0;                 // all the pages handed to the allocator
+
+// the boot modules must never be handed out, even if they are above 8 MB
+static uint32_t module_start[BUDDY_MAX_MODULES];
+static uint32_t module_end[BUDDY_MAX_MODULES];
+static int32_t module_num = 0;
+
+
+
+/*
+ * void list_push (int32_t pfn, int32_t order)
+ * inputs:          the first page of a free block and its order
+ * return value:    none
+ * outputs:         put the block at the head of its free list
+ * notes:
+ */
+static void list_push(int32_t pfn, int32_t order){
+    page_state[pfn] = order;
+    page_prev[pfn] = -1;
+    page_next[pfn] = free_head[order];
+    if (free_head[order] != -1) page_prev[free_head[order]] = pfn;
+    free_head[order] = pfn;
+    free_count[order]++;
+}
+
+
+
+/*
+ * void list_remove (int32_t pfn, int32_t order)
+ * inputs:          the first page of a free block and its order
+ * return value:    none
+ * outputs:         take the block out of its free list
+ * notes:
+ */
+static void list_remove(int32_t pfn, int32_t order){
+    if (page_prev[pfn] != -1) page_next[page_prev[pfn]] = page_next[pfn];
+    else free_head[order] = page_next[pfn];
+    if (page_next[pfn] != -1) page_prev[page_next[pfn]] = page_prev[pfn];
+    page_state[pfn] = BUDDY_NONE;
+    free_count[order]--;
+}
+
+
+
+/*
+ * void free_block (int32_t pfn, int32_t order)
+ * inputs:          the first page of a block and its order
+ * return value:    none
+ * outputs:         give the block back, merging it with its buddy as long as the buddy is free too
+ * notes:
+ */
+static void free_block(int32_t pfn, int32_t order){
+    while (order < BUDDY_MAX_ORDER){
+        int32_t buddy = pfn ^ (1 << order);
+        if (buddy >= BUDDY_PAGES || page_state[buddy] != order) break;
+        list_remove(buddy, order);
+        pfn &= ~(1 << order);       // the merged block starts at the lower one
+        order++;
+    }
+    list_push(pfn, order);
+}
+
+
+
+/*
+ * void add_range (uint32_t start, uint32_t end)
+ * inputs:          a usable physical range [start, end)
+ * return value:    none
+ * outputs:         hand every page of the range which is not reserved to the allocator
+ * notes:           the range is cut around the kernel, the boot modules and BUDDY_MAX_MEM,
+ *                  then covered with the biggest aligned blocks
+ */
+static void add_range(uint32_t start, uint32_t end){
+    int32_t i;  // loop index
+    if (start < BUDDY_RESERVED) start = BUDDY_RESERVED;
+    if (end > BUDDY_MAX_MEM) end = BUDDY_MAX_MEM;
+    start = (start + BUDDY_PAGE_SIZE - 1) & ~(BUDDY_PAGE_SIZE - 1);
+    end &= ~(BUDDY_PAGE_SIZE - 1);
+    if (start >= end) return;
+
+    for (i = 0; i < module_num; ++i){
+        if (module_start[i] < end && module_end[i] > start){
+            add_range(start, module_start[i]);
+            add_range(module_end[i], end);
+            return;
+        }
+    }
+
+    int32_t pfn = start / BUDDY_PAGE_SIZE;
+    int32_t last = end / BUDDY_PAGE_SIZE;
+    while (pfn < last){
+        int32_t order = BUDDY_MAX_ORDER;
+        while ((pfn & ((1 << order) - 1)) || pfn + (1 << order) > last) order--;
+        total_pages += 1 << order;
+        free_block(pfn, order);
+        pfn += 1 << order;
+    }
+}
+
+
+
+/*
+ * void buddy_init (multiboot_info_t* mbi)
+ * inputs:          the multiboot information
+ * return value:    none
+ * outputs:         build the free lists from the memory map, or from mem_upper
+ *                  if the boot loader gave no map
+ * notes:           must run before anything allocates frames (heap, processes)
+ */
+void buddy_init(multiboot_info_t* mbi){
+    int32_t i;  // loop index
+    for (i = 0; i < BUDDY_PAGES; ++i){
+        page_state[i] = BUDDY_NONE;
+    }
+    for (i = 0; i <= BUDDY_MAX_ORDER; ++i){
+        free_head[i] = -1;
+        free_count[i] = 0;
+    }
+    total_pages = 0;
+
+    // remember where the modules are
+    module_num = 0;
+    if (mbi->flags & (1 << 3)){
+        module_t* mod = (module_t*)mbi->mods_addr;
+        for (i = 0; i < mbi->mods_count && module_num < BUDDY_MAX_MODULES; ++i, ++mod){
+            module_start[module_num] = mod->mod_start & ~(BUDDY_PAGE_SIZE - 1);
+            module_end[module_num] = mod->mod_end;
+            module_num++;
+        }
+    }
+
+    if (mbi->flags & (1 << 6)){
+        memory_map_t* mmap;
+        for (mmap = (memory_map_t*)mbi->mmap_addr;
+                (uint32_t)mmap < mbi->mmap_addr + mbi->mmap_length;
+                mmap = (memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size))){
+            if (mmap->type != 1 || mmap->base_addr_high != 0) continue;    // 1 is usable RAM
+            uint32_t end = mmap->base_addr_low + mmap->length_low;
+            if (mmap->length_high != 0 || end < mmap->base_addr_low) end = BUDDY_MAX_MEM;
+            add_range(mmap->base_addr_low, end);
+        }
+    }
+    else if (mbi->flags & (1 << 0)){
+        // mem_upper is the memory above 1 MB, in kB
+        add_range(0x100000, 0x100000 + mbi->mem_upper * 1024);
+    }
+
+    procfs_register("buddyinfo", buddy_show);
+}
+
+
+
+/*
+ * uint32_t buddy_alloc (int32_t order)
+ * inputs:          the order of the block, 0 (4 kB) to BUDDY_MAX_ORDER (4 MB)
+ * return value:    the physical address of the block, 0 on failure
+ * outputs:         take the smallest free block which is big enough and split it
+ * notes:           the block is aligned to its size
+ */
+uint32_t buddy_alloc(int32_t order){
+    uint32_t flags;
+    int32_t cur;
+    if (order < 0 || order > BUDDY_MAX_ORDER) return 0;
+
+    cli_and_save(flags);
+    for (cur = order; cur <= BUDDY_MAX_ORDER && free_head[cur] == -1; ++cur);
+    if (cur > BUDDY_MAX_ORDER){
+        restore_flags(flags);
+        return 0;
+    }
+
+    int32_t pfn = free_head[cur];
+    list_remove(pfn, cur);
+    // the upper halves go back to the smaller lists
+    while (cur > order){
+        cur--;
+        list_push(pfn + (1 << cur), cur);
+    }
+    page_state[pfn] = BUDDY_ALLOCATED | order;
+    restore_flags(flags);
+    return (uint32_t)pfn * BUDDY_PAGE_SIZE;
+}
+
+
+
+/*
+ * int32_t buddy_free (uint32_t addr)
+ * inputs:          an address returned by buddy_alloc
+ * return value:    0 on success, -1 if addr is not an allocated block
+ * outputs:         give the block back
+ * notes:           the order is remembered by buddy_alloc
+ */
+int32_t buddy_free(uint32_t addr){
+    uint32_t flags;
+    int32_t pfn = addr / BUDDY_PAGE_SIZE;
+    if (addr & (BUDDY_PAGE_SIZE - 1) || addr >= BUDDY_MAX_MEM) return -1;
+
+    cli_and_save(flags);
+    if (page_state[pfn] == BUDDY_NONE || !(page_state[pfn] & BUDDY_ALLOCATED)){
+        restore_flags(flags);
+        return -1;
+    }
+    int32_t order = page_state[pfn] & ~BUDDY_ALLOCATED;
+    page_state[pfn] = BUDDY_NONE;
+    free_block(pfn, order);
+    restore_flags(flags);
+    return 0;
+}
+
+
+
+/*
+ * int32_t buddy_free_pages ()
+ * inputs:          none
+ * return value:    the number of free 4 kB pages
+ * outputs:         none
+ * notes:
+ */
+int32_t buddy_free_pages(){
+    int32_t i;  // loop index
+    int32_t pages = 0;
+    for (i = 0; i <= BUDDY_MAX_ORDER; ++i){
+        pages += free_count[i] << i;
+    }
+    return pages;
+}
+
+
+
+/*
+ * int32_t buddy_show (uint8_t* buf, int32_t size)
+ * inputs:          the text buffer and its size
+ * return value:    the length of the text
+ * outputs:         the text of the proc file "buddyinfo": the number of free blocks of each order
+ * notes:
+ */
+int32_t buddy_show(uint8_t* buf, int32_t size){
+    int32_t i;  // loop index
+    int32_t len = 0;
+    len = proc_puts(buf, len, size, (int8_t*)"order:  ");
+    for (i = 0; i <= BUDDY_MAX_ORDER; ++i) len = proc_putu(buf, len, size, i, 6);
+    len = proc_puts(buf, len, size, (int8_t*)"\nfree:   ");
+    for (i = 0; i <= BUDDY_MAX_ORDER; ++i) len = proc_putu(buf, len, size, free_count[i], 6);
+    len = proc_puts(buf, len, size, (int8_t*)"\npages:  ");
+    len = proc_putu(buf, len, size, buddy_free_pages(), 0);
+    len = proc_puts(buf, len, size, (int8_t*)" free of ");
+    len = proc_putu(buf, len, size, total_pages, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\n");
+    return len;
+}
@@ -0,0 +1,28 @@
+#ifndef BUDDY_H
+#define BUDDY_H
+
+#include "types.h"
+#include "multiboot.h"
+
+
+
+#define BUDDY_PAGE_SIZE     4096
+#define BUDDY_MAX_ORDER     10              // 2^10 pages, i.e. 4 MB
+#define BUDDY_MAX_MEM       0x10000000      // only the first 256 MB are managed
+#define BUDDY_PAGES         (BUDDY_MAX_MEM / BUDDY_PAGE_SIZE)
+#define BUDDY_RESERVED      0x800000        // 0 - 8 MB belong to the kernel
+#define BUDDY_MAX_MODULES   8
+
+// page_state values, the low bits hold the order of the block starting at the page
+#define BUDDY_NONE          0xFF            // not the first page of a block, or not usable memory
+#define BUDDY_ALLOCATED     0x40
+
+
+
+void buddy_init(multiboot_info_t* mbi);
+uint32_t buddy_alloc(int32_t order);
+int32_t buddy_free(uint32_t addr);
+int32_t buddy_free_pages();
+int32_t buddy_show(uint8_t* buf, int32_t size);
+
+#endif
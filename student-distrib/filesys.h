@@ -12,6 +12,7 @@
 #define RTC_FILE            0
 #define DIR_FILE            1
 #define REG_FILE            2
+#define PROC_FILE           3       // virtual file, see procfs.c
 
 // directory entry i.e. dentry 64B
 typedef struct dentry
@@ -80,4 +80,36 @@ void init_interrupt(void){
     SET_IDT_ENTRY(idt[RTC], rtc_handler);
     SET_IDT_ENTRY(idt[KEYBOARD], keyboard_handler);
     SET_IDT_ENTRY(idt[PIT], pit_handler);
+    SET_IDT_ENTRY(idt[SB16], sb16_irq_handler);
+    SET_IDT_ENTRY(idt[SERIAL], serial_irq_handler);
+}
+
+
+
+/* init_sysenter
+ * 
+ * Set up the SYSENTER MSRs so user programs can use the fast system call path.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: if the CPU does not support SYSENTER the MSRs are left alone,
+ *               and a SYSENTER from user space raises an invalid opcode exception
+ */
+void init_sysenter(void){
+    uint32_t features;
+
+    // CPUID leaf 1, EDX bit 11 is SEP (SYSENTER/SYSEXIT present)
+    asm volatile(
+        "movl $1, %%eax;"
+        "cpuid;"
+        : "=d" (features)
+        :
+        : "eax", "ebx", "ecx"
+    );
+    if ((features & CPUID_SEP) == 0) return;
+
+    // SYSENTER loads CS from the MSR and SS = CS + 8, SYSEXIT uses CS + 16 and CS + 24,
+    // which matches KERNEL_CS, KERNEL_DS, USER_CS and USER_DS in the GDT
+    wrmsr(IA32_SYSENTER_CS, KERNEL_CS);
+    wrmsr(IA32_SYSENTER_ESP, tss.esp0);     // replaced by tss.esp0 in sysenter_entry anyway
+    wrmsr(IA32_SYSENTER_EIP, (uint32_t)sysenter_entry);
 }
@@ -33,9 +33,27 @@ void exception_name() {							\
 #define RTC 		0x28
 #define KEYBOARD 	0x21
 #define PIT			0x20
+#define SB16		0x25
+#define SERIAL		0x24
+
+#define IA32_SYSENTER_CS	0x174
+#define IA32_SYSENTER_ESP	0x175
+#define IA32_SYSENTER_EIP	0x176
+#define CPUID_SEP			(1 << 11)
+
+/* Write a model specific register, the high 32 bits are always 0 */
+#define wrmsr(msr, val)						\
+do {										\
+	asm volatile ("wrmsr"					\
+			:								\
+			: "c"(msr), "a"(val), "d"(0)	\
+			: "memory"						\
+	);										\
+} while (0)
 
 volatile int32_t exception_handled;
 
 extern void init_interrupt(void);
+extern void init_sysenter(void);
 
 #endif
@@ -3,10 +3,16 @@
 
 extern void system_call(void);
 
+extern void sysenter_entry(void);
+
 extern void rtc_handler(void);
 
 extern void keyboard_handler(void);
 
 extern void pit_handler(void);
 
+extern void sb16_irq_handler(void);
+
+extern void serial_irq_handler(void);
+
 #endif
@@ -4,6 +4,9 @@
 #include "../terminal.h"
 #include "../process.h"
 #include "idt_init.h"
+#include "../ldisc.h"
+#include "../workqueue.h"
+#include "../klog.h"
 
 
 
@@ -13,9 +16,22 @@ bool Shift_Pressed = false;
 bool Cap_Pressed = false;
 bool Alt_Pressed = false;
 bool Ctrl_Pressed = false;
+bool Extended = false;          // the last scancode was EXTENDED_SC
 uint8_t temp_buf[BUFFER_SIZE];
 int32_t halt_terminal = -1;
 
+/*
+ * The interrupt handler only queues the scancodes, keyboard_work decodes and
+ * echoes them later. The handler is the only producer and keyboard_work the
+ * only consumer, so head and tail need no lock.
+ */
+static uint8_t scancode_ring[SCANCODE_RING_SIZE];
+static volatile uint32_t scancode_head = 0;     // both only grow, written by the handler
+static volatile uint32_t scancode_tail = 0;     // written by keyboard_work
+static volatile int32_t decode_queued = 0;      // 1 while keyboard_work waits in the work queue
+static uint32_t scancodes_dropped = 0;          // the ring was full, logged by keyboard_work
+static void keyboard_decode(void);
+
 /* Table for scan set code, lowercase and released shift*/
 unsigned char scanCodeSet_low[SCANCODE_NUM] = {
     0,  0, '1', '2', '3', '4', '5', '6', '7', '8',
@@ -80,14 +96,100 @@ void keyboard_init(void){
  * keyboard_interrupt
  *  DESCRIPTION: handle keyboard interrupt
  *  INPUTS: none
- *  OUTPUTS: print the pressed keyboard
+ *  OUTPUTS: none
  *  RETURN VALUE: none
- *  SIDE EFFECTS: read the pressed key, print in ASCII
+ *  SIDE EFFECTS: read the scancode into the ring and queue keyboard_work,
  *                 send eoi to keyboard port  
  */
 void keyboard_interrupt(void){
     cli();
-    scanCode = inb(KEYBOARD_DATA_PORT);
+    keyboard_scancode(inb(KEYBOARD_DATA_PORT));
+    send_eoi(KEYBOARD_IRQ);
+    work_kick();
+    sti();
+}
+
+
+
+/* 
+ * keyboard_scancode
+ *  DESCRIPTION: queue a scancode for keyboard_work
+ *  INPUTS: code -- the scancode
+ *  OUTPUTS: none
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: keyboard_work is put in the work queue unless it is there
+ *                 already, called with interrupts off
+ */
+void keyboard_scancode(uint8_t code){
+    if (scancode_head - scancode_tail < SCANCODE_RING_SIZE){
+        scancode_ring[scancode_head & (SCANCODE_RING_SIZE - 1)] = code;
+        scancode_head++;
+    }
+    else {
+        scancodes_dropped++;
+    }
+    if (!decode_queued){
+        decode_queued = (queue_work(keyboard_work, NULL) == 0);
+    }
+}
+
+
+
+/* 
+ * keyboard_work
+ *  DESCRIPTION: decode every queued scancode
+ *  INPUTS: arg -- unused
+ *  OUTPUTS: print the pressed keys
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: runs from the work queue. It is off the queue already, so a
+ *                 scancode arriving from now on queues it again, the worker
+ *                 may be preempted between two scancodes
+ */
+void keyboard_work(void* arg){
+    decode_queued = 0;
+    while (keyboard_decode_next() == 0);
+}
+
+
+
+/* 
+ * keyboard_decode_next
+ *  DESCRIPTION: decode the oldest queued scancode
+ *  INPUTS: none
+ *  OUTPUTS: print the pressed key
+ *  RETURN VALUE: 0 if a scancode was decoded, -1 if the ring is empty
+ *  SIDE EFFECTS: interrupts are only off to take the scancode from the ring,
+ *                 it is decoded and echoed with them on. Every edit of the
+ *                 screen or of the input line disables them by itself
+ */
+int32_t keyboard_decode_next(void){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (scancode_tail == scancode_head){
+        uint32_t dropped = scancodes_dropped;
+        scancodes_dropped = 0;
+        restore_flags(flags);
+        if (dropped != 0) klog(KLOG_WARN, "keyboard: %d scancodes dropped", dropped);
+        return -1;
+    }
+    scanCode = scancode_ring[scancode_tail & (SCANCODE_RING_SIZE - 1)];
+    scancode_tail++;
+    restore_flags(flags);
+    keyboard_decode();
+    return 0;
+}
+
+
+
+/* 
+ * keyboard_decode
+ *  DESCRIPTION: handle one scancode
+ *  INPUTS: none, the scancode is in scanCode
+ *  OUTPUTS: print the pressed keyboard
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: read the pressed key, print in ASCII
+ */
+static void keyboard_decode(void){
     //handler specicific scancode
     switch (scanCode)
     {
@@ -95,13 +197,16 @@ void keyboard_interrupt(void){
     case CAP_P_SC:
         Cap_Pressed = ~Cap_Pressed;
         break;
+    case EXTENDED_SC:
+        Extended = true;
+        break;
     case LSHIFT_P_SC: 
     case RSHIFT_P_SC:
-        Shift_Pressed = true;
+        if (!Extended) Shift_Pressed = true;    // the keyboard wraps some extended keys in fake shifts
         break;
     case LSHIFT_R_SC: 
     case RSHIFT_R_SC:
-        Shift_Pressed = false;
+        if (!Extended) Shift_Pressed = false;
         break;
     case ALT_P_SC: 
         Alt_Pressed = true;
@@ -167,6 +272,16 @@ void keyboard_interrupt(void){
     case DOWN:
         search_history(0);
         break;
+    case PGUP:
+        if (Shift_Pressed){
+            scrollback_scroll(NUM_ROWS - 1);
+        }
+        break;
+    case PGDN:
+        if (Shift_Pressed){
+            scrollback_scroll(-(NUM_ROWS - 1));
+        }
+        break;
 
     //normal scancode   
     default:
@@ -184,8 +299,7 @@ void keyboard_interrupt(void){
             }
         }
     }
-    send_eoi(KEYBOARD_IRQ);
-    sti();
+    if (scanCode != EXTENDED_SC) Extended = false;
 }
 
 
@@ -199,10 +313,12 @@ void keyboard_interrupt(void){
  *  SIDE EFFECTS: store the pressed key into keyboard buffer
  */
 void normal_key(uint8_t scanCode){
+    uint32_t flags;
     unsigned char key_print;
 
     //judge the current scanCode mode
-    if ((scanCode <= SCANCODE_NUM) && (display_terminal->read_count < BUFFER_SIZE - 1)){// last two char for '\n'
+    int32_t raw = ldisc_raw(display_terminal);
+    if ((scanCode <= SCANCODE_NUM) && (raw || display_terminal->read_count < LINE_MAX - 1)){// last char for '\n'
         if (Cap_Pressed){
             if(Shift_Pressed){
                 key_print = scanCodeSet_high_shift[scanCode];
@@ -224,14 +340,26 @@ void normal_key(uint8_t scanCode){
         return;
     }
 
+    // typing goes back from the scrollback to the screen
+    if (key_print != 0 && display_terminal->sb_view != 0){
+        scrollback_scroll(-display_terminal->sb_view);
+    }
+
+    // a raw program gets every key as it is, without echo
+    if (raw){
+        if (key_print != 0) ldisc_raw_put(display_terminal, key_print);
+        return;
+    }
+    // the line was finished but not read yet
+    if (display_terminal->flag_function == 1 && display_terminal->input_done == 1) return;
+
     //handle specific character
     switch (key_print)
     {
     case '\b':
         if(display_terminal->read_count > 0){
             deletec(0);
-            display_terminal->keyboard_buf[display_terminal->read_count] = 0;
-            display_terminal->read_count -= 1;
+            ldisc_erase(display_terminal);
         }
         break;
     case '\t':
@@ -239,22 +367,22 @@ void normal_key(uint8_t scanCode){
         break;
     case '\n':
         putc_visible(key_print);
+        cli_and_save(flags);            // terminal_read takes the line as soon as input_done is set
         if (display_terminal->flag_function == 0){
             display_terminal->read_count = 0;
             clear_keyboard_buffer();    // clear the keyboard_buffer
         }
         else if (display_terminal->flag_function == 1){
-            display_terminal->keyboard_buf[display_terminal->read_count] = '\n';
+            ldisc_putc(display_terminal, '\n');    // always fits
             display_terminal->read_count = 0;
             display_terminal->input_done = 1;
         }
+        restore_flags(flags);
         break;
     case 0:
         break;
     default:
-        display_terminal->keyboard_buf[display_terminal->read_count] = key_print;
-        putc_visible(key_print);
-        display_terminal->read_count += 1;
+        if (ldisc_putc(display_terminal, key_print) == 0) putc_visible(key_print);
         break;
     }
 }
@@ -267,13 +395,10 @@ void normal_key(uint8_t scanCode){
  *  INPUTS: none
  *  OUTPUTS: none
  *  RETURN VALUE: none
- *  SIDE EFFECTS: clear keyboard buffer
+ *  SIDE EFFECTS: clear keyboard buffer, a long line buffer goes back to its pool
  */
 void clear_keyboard_buffer(void){
-    int i = 0;
-    for(;i < BUFFER_SIZE; i++){
-        display_terminal->keyboard_buf[i] = 0;
-    }
+    ldisc_reset(display_terminal);
 }
 
 
@@ -305,7 +430,10 @@ void tab_pressed(void){
         uint8_t temp[BUFFER_SIZE];
         int i = display_terminal->read_count-1;
         int j = 0;
-        while (i >= 0 && display_terminal->keyboard_buf[i] != ' ') temp[j++] = display_terminal->keyboard_buf[i--];
+        while (i >= 0 && display_terminal->keyboard_buf[i] != ' '){
+            if (j == BUFFER_SIZE - 1) return;       // no file name is that long
+            temp[j++] = display_terminal->keyboard_buf[i--];
+        }
         j--;
         i = 0;
         while (j >= 0) pre[i++] = temp[j--];
@@ -351,9 +479,8 @@ void tab_pressed(void){
             ((char*)temp)[len] = '\0';
             for (i = 0, j = 0; temp[j] != '\0'; i++,j++){
                 if (i < match_len) continue;
-                display_terminal->keyboard_buf[display_terminal->read_count] = temp[j];
+                if (display_terminal->read_count >= LINE_MAX - 1 || ldisc_putc(display_terminal, temp[j]) != 0) break;
                 putc_visible(temp[j]);
-                display_terminal->read_count++;
             }
         }
     }    
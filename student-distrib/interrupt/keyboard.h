@@ -27,6 +27,10 @@
 #define F3_SC               0x3D        //F3 pressed scancode
 #define UP                  0x48
 #define DOWN                0x50
+#define PGUP                0x49
+#define PGDN                0x51
+#define EXTENDED_SC         0xE0        //prefix of the extended keys
+#define SCANCODE_RING_SIZE  64          //scancodes waiting to be decoded, must be a power of 2
 
 /* the scanCode of pressed key */
 uint8_t scanCode;
@@ -46,4 +50,13 @@ void keyboard_init(void);
 
 /*handle keyboard interrupt*/
 void keyboard_interrupt(void);
+
+/*queue a scancode to be decoded later*/
+void keyboard_scancode(uint8_t code);
+
+/*decode the queued scancodes, runs as deferred work*/
+void keyboard_work(void* arg);
+
+/*decode the oldest queued scancode*/
+int32_t keyboard_decode_next(void);
 #endif
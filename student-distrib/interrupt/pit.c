@@ -1,5 +1,7 @@
 #include "pit.h"
 
+volatile uint32_t pit_ticks = 0;       // interrupts since pit_init, FRE a second
+
 
 /* 
  * pit_phase
@@ -28,7 +30,7 @@ void pit_phase(uint32_t hz){
  */
 void pit_init(){
     enable_irq(IRQ0);
-    pit_phase(100);
+    pit_phase(FRE);
 }
 
 
@@ -43,6 +45,7 @@ void pit_init(){
  */
 void pit_interrupt() {
     cli();
+    pit_ticks++;
     send_eoi(IRQ0);
     schedule();
     sti();
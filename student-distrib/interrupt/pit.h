@@ -13,6 +13,8 @@
 #define FRE                 100     //setting to 100Hz
 #define IRQ0                0x0      
 
+extern volatile uint32_t pit_ticks;
+
 void pit_init();
 void pit_interrupt();
 void pit_phase(uint32_t hz);
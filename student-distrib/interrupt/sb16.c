@@ -1,4 +1,5 @@
 #include "sb16.h"
+#include "../klog.h"
 
 #define BLK_SIZE     (32*1024)
 #define BUF_SIZE     (2*BLK_SIZE)
@@ -179,7 +180,7 @@ int8_t play_music(uint8_t* filename){
     }
     dentry_t audio_dentry;
     if (read_dentry_by_name(filename, &audio_dentry) == -1){
-        printf("No Such File");
+        klog(KLOG_WARN, "play_music: no such file %s", filename);
         return -1;
     }else{
         audio_file_inode = audio_dentry.inode;
@@ -187,7 +188,7 @@ int8_t play_music(uint8_t* filename){
     uint8_t magic[4];
     read_data(audio_file_inode, 0, magic, 4);
     if(*((uint32_t*)magic) != RIFF){
-        printf("file cannot be played! %s\n", magic);
+        klog(KLOG_WARN, "play_music: %s is not a RIFF file", filename);
         return -1;
     }
 
@@ -251,21 +252,21 @@ void stop(){
 }
 
 /*
- * void sb16_handler()
+ * void sb16_refill(void* arg)
  * 
- * Description: handle sb16 interrupt
- * Input:       None
+ * Description: deferred part of the sb16 interrupt, refill the half of the
+ *              DMA buffer which has just been played
+ * Input:       unused
  * Output:      None
- * SideEffect:  check the state and play the music
+ * SideEffect:  read the next block of the audio file and start playing it
  * 
  */
-void sb16_handler(){
-    DSP_inb(0xE);
-    send_eoi(5);
-    cli();
+void sb16_refill(void* arg){
+    if(is_playing == 0){
+        return;
+    }
     uint32_t bytes_read = read_data(audio_file_inode, current_offset, (uint8_t*)cur_block, BLK_SIZE);
     current_offset += bytes_read;
-    sti();
 
     if(bytes_read == BLK_SIZE){
         uint16_t blksize = (uint16_t) bytes_read;
@@ -278,6 +279,21 @@ void sb16_handler(){
     }else if(bytes_read == 0){
         stop();
     }
-    return;
 }
 
+/*
+ * void sb16_handler()
+ * 
+ * Description: handle sb16 interrupt
+ * Input:       None
+ * Output:      None
+ * SideEffect:  acknowledge the DSP and defer the buffer refill to the work queue,
+ *              so the 32 kB read does not run with interrupts disabled
+ * 
+ */
+void sb16_handler(){
+    DSP_inb(DSP_Read_Buffer_Status);
+    send_eoi(SB16_IRQ);
+    queue_work(sb16_refill, NULL);
+    work_kick();
+}
@@ -1,6 +1,7 @@
 #include "../library/lib.h"
 #include "sys_call.h"
 #include "../filesys.h"
+#include "../workqueue.h"
 
 #ifndef _DB16_H
 #define _DB16_H
@@ -10,6 +11,7 @@
 #define DSP_Write               0xC
 #define DSP_Read_Buffer_Status  0xE
 #define SB16_IOBase             0x220
+#define SB16_IRQ                5
 #define SB_OUTPUT_RATE          0x41
 
 #define DMA_1_MASK              0x0A
@@ -31,6 +33,7 @@ uint8_t Read_From_DSP();
 int8_t Transfer_Sound_DMA(uint8_t channel, uint8_t mode, uint32_t addr, uint32_t size);
 int8_t Set_Sample_Rate(uint16_t frequency);
 void sb16_handler();
+void sb16_refill(void* arg);
 int8_t play_music(uint8_t* filename);
 void start_play(uint32_t block_size);
 void stop();
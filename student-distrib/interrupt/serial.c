@@ -0,0 +1,148 @@
+#include "serial.h"
+#include "i8259.h"
+#include "../library/lib.h"
+#include "../procfs.h"
+
+/*
+ *  The serial console on COM1. It only sends, the console output is copied
+ *  into tx_ring and the transmitter interrupt drains the ring a FIFO at a
+ *  time, so a writer never waits for the UART. Once the ring is full the
+ *  rest of a write is dropped and counted instead.
+ */
+static uint8_t tx_ring[SERIAL_RING];
+static volatile uint32_t tx_head = 0;       // the next byte to send, both only grow
+static volatile uint32_t tx_tail = 0;       // where the next byte is put
+static int32_t serial_present = 0;          // 1 once serial_init found the UART
+static int32_t tx_burst = 1;                // bytes the transmitter takes when THRE is set
+static int32_t tx_enabled = 0;              // 1 while the THRE interrupt is on
+static uint32_t tx_sent = 0;
+static uint32_t tx_dropped = 0;
+
+/* serial_init
+ * 
+ * Check that COM1 is there, set it to 115200 8N1 and enable its IRQ.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: without a UART all the output is dropped
+ */
+void serial_init(void) {
+    uint32_t flags;
+    cli_and_save(flags);
+    outb(0x00, COM1_BASE + UART_IER);                   // no interrupts while setting up
+    outb(LCR_DLAB, COM1_BASE + UART_LCR);
+    outb(SERIAL_DIVISOR & 0xFF, COM1_BASE + UART_DATA);
+    outb(SERIAL_DIVISOR >> 8, COM1_BASE + UART_IER);
+    outb(LCR_8N1, COM1_BASE + UART_LCR);
+    outb(FCR_ENABLE, COM1_BASE + UART_FCR);
+
+    // send a byte to itself, a missing or broken UART does not give it back
+    outb(MCR_LOOPBACK | MCR_OUT, COM1_BASE + UART_MCR);
+    outb(0xAE, COM1_BASE + UART_DATA);
+    if (inb(COM1_BASE + UART_DATA) != 0xAE) {
+        restore_flags(flags);
+        return;
+    }
+    outb(MCR_OUT, COM1_BASE + UART_MCR);
+
+    if ((inb(COM1_BASE + UART_IIR) & IIR_FIFO) == IIR_FIFO) tx_burst = SERIAL_FIFO;
+    serial_present = 1;
+    enable_irq(COM1_IRQ);
+    procfs_register("serial", serial_show);
+    restore_flags(flags);
+}
+
+/* tx_fill
+ * 
+ * Move as many bytes from the ring to the transmitter as it takes now.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: the THRE interrupt is off once the ring is empty. Called with interrupts off
+ */
+static void tx_fill(void) {
+    int32_t i;
+    if (inb(COM1_BASE + UART_LSR) & LSR_THRE) {
+        for (i = 0; i < tx_burst && tx_head != tx_tail; ++i) {
+            outb(tx_ring[tx_head & (SERIAL_RING - 1)], COM1_BASE + UART_DATA);
+            tx_head++;
+            tx_sent++;
+        }
+    }
+    if (tx_head == tx_tail && tx_enabled) {
+        outb(0x00, COM1_BASE + UART_IER);
+        tx_enabled = 0;
+    }
+    else if (tx_head != tx_tail && !tx_enabled) {
+        outb(IER_THRE, COM1_BASE + UART_IER);
+        tx_enabled = 1;
+    }
+}
+
+/* serial_interrupt
+ * 
+ * The transmitter is empty, give it the next bytes of the ring.
+ * Inputs: None
+ * Outputs: None
+ * Side Effects: None
+ */
+void serial_interrupt(void) {
+    uint32_t flags;
+    cli_and_save(flags);
+    inb(COM1_BASE + UART_IIR);          // reading IIR acknowledges the THRE interrupt
+    tx_fill();
+    send_eoi(COM1_IRQ);
+    restore_flags(flags);
+}
+
+/* serial_write
+ * 
+ * Queue bytes for COM1, '\n' is sent as "\r\n" for terminals on the other end
+ * and '\0' is skipped like on the screen.
+ * Inputs: buf -- the bytes
+ *         nbytes -- the number of bytes
+ * Outputs: the number of bytes queued, the rest did not fit and was dropped
+ * Side Effects: never waits for the UART
+ */
+int32_t serial_write(const int8_t* buf, int32_t nbytes) {
+    uint32_t flags;
+    int32_t i;
+    if (!serial_present || buf == NULL || nbytes <= 0) return 0;
+
+    cli_and_save(flags);
+    for (i = 0; i < nbytes; ++i) {
+        if (buf[i] == '\0') continue;
+        int32_t need = (buf[i] == '\n') ? 2 : 1;
+        if (tx_tail - tx_head + need > SERIAL_RING) {
+            tx_dropped += nbytes - i;
+            break;
+        }
+        if (buf[i] == '\n') tx_ring[tx_tail++ & (SERIAL_RING - 1)] = '\r';
+        tx_ring[tx_tail++ & (SERIAL_RING - 1)] = buf[i];
+    }
+    tx_fill();
+    restore_flags(flags);
+    return i;
+}
+
+/* serial_show
+ * 
+ * The text of the proc file "serial".
+ * Inputs: buf -- the text buffer
+ *         size -- its size
+ * Outputs: the length of the text
+ * Side Effects: None
+ */
+int32_t serial_show(uint8_t* buf, int32_t size) {
+    int32_t len = 0;
+    len = proc_puts(buf, len, size, (int8_t*)"sent:     ");
+    len = proc_putu(buf, len, size, tx_sent, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\ndropped:  ");
+    len = proc_putu(buf, len, size, tx_dropped, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\nqueued:   ");
+    len = proc_putu(buf, len, size, tx_tail - tx_head, 0);
+    len = proc_puts(buf, len, size, (int8_t*)" of ");
+    len = proc_putu(buf, len, size, SERIAL_RING, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\nfifo:     ");
+    len = proc_putu(buf, len, size, tx_burst, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\n");
+    return len;
+}
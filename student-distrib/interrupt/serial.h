@@ -0,0 +1,37 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "../types.h"
+
+#define COM1_BASE           0x3F8
+#define COM1_IRQ            4
+
+// registers of the 16550, offsets from the base port
+#define UART_DATA           0           // THR when written, RBR when read, divisor low with DLAB
+#define UART_IER            1           // interrupt enable, divisor high with DLAB
+#define UART_IIR            2           // interrupt identification when read
+#define UART_FCR            2           // FIFO control when written
+#define UART_LCR            3           // line control
+#define UART_MCR            4           // modem control
+#define UART_LSR            5           // line status
+#define UART_SCRATCH        7
+
+#define IER_THRE            0x02        // interrupt when the transmitter holding register is empty
+#define LCR_DLAB            0x80        // the first two registers are the baud rate divisor
+#define LCR_8N1             0x03        // 8 data bits, no parity, 1 stop bit
+#define FCR_ENABLE          0xC7        // enable and clear both FIFOs, receive trigger at 14 bytes
+#define IIR_FIFO            0xC0        // both bits set if the FIFOs work, i.e. a 16550A
+#define MCR_LOOPBACK        0x10
+#define MCR_OUT             0x0B        // DTR, RTS and OUT2, OUT2 connects the IRQ line
+#define LSR_THRE            0x20        // the transmitter holding register (or its FIFO) is empty
+
+#define SERIAL_DIVISOR      1           // 115200 baud
+#define SERIAL_FIFO         16          // bytes the transmitter FIFO of a 16550A takes at once
+#define SERIAL_RING         4096        // bytes waiting to be sent, a power of 2
+
+void serial_init(void);
+void serial_interrupt(void);
+int32_t serial_write(const int8_t* buf, int32_t nbytes);
+int32_t serial_show(uint8_t* buf, int32_t size);
+
+#endif /* SERIAL_H */
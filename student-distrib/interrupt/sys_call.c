@@ -1,4 +1,6 @@
 #include "sys_call.h"
+#include "../vga.h"
+#include "../ldisc.h"
 
 extern int32_t process_counter;     // counts the number of existing process 
 extern int32_t running_process;     // records the current running process, -1 indicates no running process
@@ -22,6 +24,13 @@ file_operations_391_t dir_operation = {
     .close = dir_close
 };
 
+file_operations_391_t proc_operation = {
+    .open = proc_open,
+    .read = proc_read,
+    .write = proc_write,
+    .close = proc_close
+};
+
 file_operations_391_t file_operation = {
     .open = file_open,
     .read = file_read,
@@ -33,7 +42,8 @@ file_operations_391_t terminal_operation = {
     .open = terminal_open,
     .read = terminal_read,
     .write = terminal_write,
-    .close = terminal_close
+    .close = terminal_close,
+    .writev = terminal_writev
 };
 
 
@@ -146,7 +156,10 @@ int32_t open (const uint8_t* filename){
     uint32_t file_type;
 
     if(-1 == read_dentry_by_name(filename,&temp_dentry)){
-        return -1;
+        // not on the disk, it may still be a proc file
+        if(-1 == procfs_lookup(filename,&temp_dentry)){
+            return -1;
+        }
     }
 
     //initialize the file descriptor
@@ -167,6 +180,10 @@ int32_t open (const uint8_t* filename){
         fd_array[i].inode = temp_dentry.inode;
         fd_array[i].operation_pointer = &file_operation;
         break;
+    case PROC_FILE:
+        fd_array[i].inode = temp_dentry.inode;
+        fd_array[i].operation_pointer = &proc_operation;
+        break;
     default:
         fd_array[i].flags = 0;
         return -1;
@@ -213,16 +230,15 @@ int32_t close (int32_t fd){
  *  RETURN VALUE: 0 for success, -1 for failure
  */
 int32_t getargs (uint8_t* buf, int32_t nbytes){
-    if (!buf) return -1;
+    if (!buf || nbytes < 1) return -1;
     PCB_t* pcb = get_PCB(running_process);
     if (!pcb) return -1;
     if (pcb->arg[0] == '\0') return -1;
-    int arg_idx = 0;
-    while (arg_idx + 1 < nbytes && pcb->arg[arg_idx] != '\0'){
-        buf[arg_idx] = pcb->arg[arg_idx];
-        arg_idx++;
-    }
-    buf[arg_idx] = '\0';
+    int32_t len = strlen((int8_t*)pcb->arg);
+    if (len > nbytes - 1) len = nbytes - 1;     // keep room for the '\0'
+    if (bad_userspace_addr(buf, len + 1)) return -1;
+    memcpy(buf, pcb->arg, len);
+    buf[len] = '\0';
     return 0;
 }
 
@@ -239,18 +255,265 @@ int32_t getargs (uint8_t* buf, int32_t nbytes){
  */
 int32_t vidmap (uint8_t** screen_start){
     // validate the argument
-    if ((uint32_t)screen_start < VIR_USER_PRO || (uint32_t)screen_start >= VIR_USER_END) return -1;
-    if (running_process == -1) return -1;
+    if (bad_userspace_addr(screen_start, sizeof(uint8_t*))) return -1;
 
     PCB_t* ptr = get_PCB(running_process);
-    vidmem_paging(VIDEO_MEM_ADDR);        // set up the mapping, note the start of the screen is at 144MB (virtual)
-    *screen_start = (uint8_t*)SCREEN_START;
+    uint8_t* start = (uint8_t*)SCREEN_START;
+    vidmem_paging(running_terminal->video_mem_buf);     // set up the mapping, note the start of the screen is at 144MB (virtual)
+    if (-1 == copy_to_user(screen_start, &start, sizeof(start))) return -1;
     ptr->flag_vidmem = 1;
+    screen_home(running_terminal->tid);     // the program draws at the start of the video memory of its terminal
     return 0;
 };
 
 
 
+/* 
+ *  int32_t vidmap_fb (uint8_t** fb_start)
+ *  DESCRIPTION:    system call -- switch to 320x200 with 256 colors and map a
+ *                  frame buffer of one byte a pixel (RRRGGGBB) into user space
+ *  INPUTS:         fb_start -- where the address of the frame buffer is stored
+ *  OUTPUTS:        the screen shows the frame buffer while the terminal of
+ *                  the process is shown, until the process halts
+ *  RETURN VALUE:   0 on success, -1 on failure or if another process has it
+ */
+int32_t vidmap_fb (uint8_t** fb_start){
+    if (bad_userspace_addr(fb_start, sizeof(uint8_t*))) return -1;
+
+    uint8_t* start = (uint8_t*)FB_START;
+    if (-1 == fb_claim()) return -1;
+    return copy_to_user(fb_start, &start, sizeof(start));
+}
+
+
+
+/* 
+ *  int32_t fb_flip (void)
+ *  DESCRIPTION:    system call -- show the frame buffer mapped by vidmap_fb
+ *  INPUTS:         none
+ *  OUTPUTS:        the frame buffer is copied to the screen in the next vertical
+ *                  retrace, so a program calling this once a frame does not tear
+ *  RETURN VALUE:   0 on success, -1 if the process has no frame buffer
+ */
+int32_t fb_flip (void){
+    return fb_present();
+}
+
+
+
+/* 
+ *  int32_t tty_mode (int32_t mode)
+ *  DESCRIPTION:    system call -- choose how read takes the keys of the terminal
+ *  INPUTS:         mode -- TTY_CANON for edited lines, TTY_RAW for every key at once without echo
+ *  OUTPUTS:        the keys typed so far are dropped when the mode changes
+ *  RETURN VALUE:   the old mode, -1 for failure
+ */
+int32_t tty_mode (int32_t mode){
+    if (running_process == -1 || (mode != TTY_CANON && mode != TTY_RAW)) return -1;
+    PCB_t* pcb = get_PCB(running_process);
+    int32_t old = pcb->tty_mode;
+    if (mode != old){
+        pcb->tty_mode = mode;
+        ldisc_flush(running_terminal);
+    }
+    return old;
+}
+
+
+
+/* 
+ *  int32_t readv (int32_t fd, const iovec_t* iov, int32_t iovcnt)
+ *  DESCRIPTION: system call -- vectored read, fill the buffers in order
+ *  INPUTS:     fd -- file descriptor index
+ *              iov -- array of buffers
+ *              iovcnt -- the number of buffers, 1 to MAX_IOV
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the total number of bytes read, -1 for failure
+ */
+int32_t readv (int32_t fd, const iovec_t* iov, int32_t iovcnt){
+    //check input validity
+    if(fd < 0 || fd >= MAX_FILES || (!iov) || iovcnt < 1 || iovcnt > MAX_IOV || 1 == fd){
+        return -1;
+    }
+    //the file is closed
+    if(0 == fd_array[fd].flags){
+        return -1;
+    }
+
+    int32_t i;
+    iovec_t vec[MAX_IOV];
+    if (-1 == copy_from_user(vec, iov, iovcnt * sizeof(iovec_t))) return -1;
+    for (i = 0; i < iovcnt; i++){
+        if (bad_userspace_addr(vec[i].iov_base, vec[i].iov_len)) return -1;
+    }
+
+    if (fd_array[fd].operation_pointer->readv != NULL){
+        return fd_array[fd].operation_pointer->readv(fd, vec, iovcnt);
+    }
+
+    // no vectored version, read buffer by buffer and stop at the first short read
+    int32_t total = 0;
+    for (i = 0; i < iovcnt; i++){
+        int32_t len = fd_array[fd].operation_pointer->read(fd, vec[i].iov_base, vec[i].iov_len);
+        if (len == -1) return (total == 0) ? -1 : total;
+        total += len;
+        if (len < vec[i].iov_len) break;
+    }
+    return total;
+}
+
+
+
+/* 
+ *  int32_t writev (int32_t fd, const iovec_t* iov, int32_t iovcnt)
+ *  DESCRIPTION: system call -- vectored write, write the buffers in order with one trap
+ *  INPUTS:     fd -- file descriptor index
+ *              iov -- array of buffers
+ *              iovcnt -- the number of buffers, 1 to MAX_IOV
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the total number of bytes written, -1 for failure
+ */
+int32_t writev (int32_t fd, const iovec_t* iov, int32_t iovcnt){
+    //check input validity
+    if(fd < 1 || fd >= MAX_FILES || (!iov) || iovcnt < 1 || iovcnt > MAX_IOV){
+        return -1;
+    }
+    //the file is closed
+    if(0 == fd_array[fd].flags){
+        return -1;
+    }
+
+    int32_t i;
+    iovec_t vec[MAX_IOV];
+    if (-1 == copy_from_user(vec, iov, iovcnt * sizeof(iovec_t))) return -1;
+    for (i = 0; i < iovcnt; i++){
+        if (bad_userspace_addr(vec[i].iov_base, vec[i].iov_len)) return -1;
+    }
+
+    if (fd_array[fd].operation_pointer->writev != NULL){
+        return fd_array[fd].operation_pointer->writev(fd, vec, iovcnt);
+    }
+
+    // no vectored version, write buffer by buffer
+    int32_t total = 0;
+    for (i = 0; i < iovcnt; i++){
+        int32_t len = fd_array[fd].operation_pointer->write(fd, vec[i].iov_base, vec[i].iov_len);
+        if (len == -1) return (total == 0) ? -1 : total;
+        total += len;
+        if (len < vec[i].iov_len) break;
+    }
+    return total;
+}
+
+
+
+/* 
+ *  int32_t set_brk (PCB_t* pcb, uint32_t new_brk)
+ *  DESCRIPTION: move the end of the user heap
+ *  INPUTS:     the process and the new end
+ *  OUTPUTS:    memory the heap grows into is cleared, it may hold data of an earlier process
+ *  RETURN VALUE: 0 on success, -1 if the end would leave [brk_start, stack reserve]
+ */
+static int32_t set_brk (PCB_t* pcb, uint32_t new_brk){
+    if (new_brk < pcb->brk_start || new_brk > VIR_USER_END - USER_STACK_RESERVE) return -1;
+    if (new_brk > pcb->brk) memset((void*)pcb->brk, 0, new_brk - pcb->brk);
+    pcb->brk = new_brk;
+    return 0;
+}
+
+
+
+/* 
+ *  int32_t brk (void* addr)
+ *  DESCRIPTION: system call -- set the end of the user heap
+ *  INPUTS:     addr -- the new end, anywhere between the end of the program
+ *              and the stack reserve at the top of the user page
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 0 on success, -1 for failure
+ */
+int32_t brk (void* addr){
+    if (running_process == -1) return -1;
+    return set_brk(get_PCB(running_process), (uint32_t)addr);
+}
+
+
+
+/* 
+ *  int32_t sbrk (int32_t increment)
+ *  DESCRIPTION: system call -- grow or shrink the user heap
+ *  INPUTS:     increment -- the number of bytes to add, may be negative or 0
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the old end of the heap, i.e. the start of the new memory, -1 for failure
+ */
+int32_t sbrk (int32_t increment){
+    if (running_process == -1) return -1;
+    PCB_t* pcb = get_PCB(running_process);
+    uint32_t old_brk = pcb->brk;
+    if (increment > 0 && (uint32_t)increment > VIR_USER_END - old_brk) return -1;   // wraps around
+    if (-1 == set_brk(pcb, old_brk + increment)) return -1;
+    return (int32_t)old_brk;
+}
+
+
+
+/* 
+ *  int32_t sys_execute (const uint8_t* command)
+ *  DESCRIPTION: system call entry of execute, the command is copied into the kernel first
+ *  INPUTS:     command -- user string
+ *  OUTPUTS:    create a new process
+ *  RETURN VALUE: same as execute
+ */
+int32_t sys_execute (const uint8_t* command){
+    uint8_t kcommand[LINE_MAX];         // the shell reads lines of up to LINE_MAX bytes
+    if (-1 == safe_strncpy((int8_t*)kcommand, (const int8_t*)command, LINE_MAX)) return -1;
+    return execute(kcommand);
+}
+
+
+
+/* 
+ *  int32_t sys_read (int32_t fd, void* buf, int32_t nbytes)
+ *  DESCRIPTION: system call entry of read, the whole buffer is checked once
+ *  INPUTS:     same as read
+ *  OUTPUTS:    none
+ *  RETURN VALUE: same as read
+ */
+int32_t sys_read (int32_t fd, void* buf, int32_t nbytes){
+    if (bad_userspace_addr(buf, nbytes)) return -1;
+    return read(fd, buf, nbytes);
+}
+
+
+
+/* 
+ *  int32_t sys_write (int32_t fd, const void* buf, int32_t nbytes)
+ *  DESCRIPTION: system call entry of write, the whole buffer is checked once
+ *  INPUTS:     same as write
+ *  OUTPUTS:    none
+ *  RETURN VALUE: same as write
+ */
+int32_t sys_write (int32_t fd, const void* buf, int32_t nbytes){
+    if (bad_userspace_addr(buf, nbytes)) return -1;
+    return write(fd, buf, nbytes);
+}
+
+
+
+/* 
+ *  int32_t sys_open (const uint8_t* filename)
+ *  DESCRIPTION: system call entry of open, the name is copied into the kernel first
+ *  INPUTS:     filename -- user string
+ *  OUTPUTS:    none
+ *  RETURN VALUE: same as open
+ */
+int32_t sys_open (const uint8_t* filename){
+    uint8_t kname[MAX_FILENAME_LEN + 1];
+    if (-1 == safe_strncpy((int8_t*)kname, (const int8_t*)filename, MAX_FILENAME_LEN + 1)) return -1;
+    return open(kname);
+}
+
+
+
 /*** extra credit ***/
 int32_t set_handler (int32_t signum, void* handler_address){return -1;};
 int32_t sigreturn (void){return -1;};
@@ -7,6 +7,8 @@
 #include "../types.h"
 #include "../terminal.h"
 #include "../process.h"
+#include "../library/uaccess.h"
+#include "../procfs.h"
 
 
 
@@ -20,5 +22,18 @@ int32_t getargs (uint8_t* buf, int32_t nbytes);
 int32_t vidmap (uint8_t** screen_start);
 int32_t set_handler (int32_t signum, void* handler_address);
 int32_t sigreturn (void);
+int32_t readv (int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t writev (int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t brk (void* addr);
+int32_t sbrk (int32_t increment);
+int32_t vidmap_fb (uint8_t** fb_start);
+int32_t fb_flip (void);
+int32_t tty_mode (int32_t mode);
+
+/* entry points used by user programs, they check the user pointers first */
+int32_t sys_execute (const uint8_t* command);
+int32_t sys_read (int32_t fd, void* buf, int32_t nbytes);
+int32_t sys_write (int32_t fd, const void* buf, int32_t nbytes);
+int32_t sys_open (const uint8_t* filename);
 
 #endif
@@ -0,0 +1,153 @@
+/*
+*   The system call linkage calls syscall_stats_record() after every system
+*   call with the number of TSC cycles it took. The tables are only updated
+*   with single incl instructions, which an interrupt can not split on this
+*   single CPU, so no lock is needed and a reader may run at any time.
+*/
+
+#include "syscall_stats.h"
+#include "../procfs.h"
+#include "../process.h"
+
+extern int32_t running_process;     // records the current running process, -1 indicates no running process
+
+static syscall_stats_t global_stats;
+static syscall_stats_t process_stats[MAX_PROCESS];
+
+static const int8_t* syscall_names[SYSCALL_NUM + 1] = {
+    "", "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "readv", "writev",
+    "brk", "sbrk", "vidmap_fb", "fb_flip", "tty_mode"
+};
+
+
+
+/*
+ * void stat_inc (uint32_t* counter)
+ * inputs:          the counter
+ * return value:    none
+ * outputs:         add one to the counter in a single instruction
+ * notes:
+ */
+static inline void stat_inc(uint32_t* counter){
+    asm volatile ("incl %0" : "+m" (*counter) : : "cc");
+}
+
+
+
+/*
+ * int32_t hist_bucket (uint32_t cycles)
+ * inputs:          the number of cycles a call took
+ * return value:    the histogram bucket, bucket i >= 1 holds [2^(i+6), 2^(i+7)) cycles
+ * outputs:         none
+ * notes:           the last bucket also holds everything slower
+ */
+static int32_t hist_bucket(uint32_t cycles){
+    uint32_t msb;
+    if (cycles < (1 << SYSCALL_HIST_SHIFT)) return 0;
+    asm ("bsrl %1, %0" : "=r" (msb) : "r" (cycles));
+    msb = msb - SYSCALL_HIST_SHIFT + 1;
+    return (msb >= SYSCALL_HIST_BUCKETS) ? SYSCALL_HIST_BUCKETS - 1 : msb;
+}
+
+
+
+/*
+ * void syscall_stats_init ()
+ * inputs:          none
+ * return value:    none
+ * outputs:         clear the tables and register the proc file "syscalls"
+ * notes:
+ */
+void syscall_stats_init(){
+    memset(&global_stats, 0, sizeof(global_stats));
+    memset(process_stats, 0, sizeof(process_stats));
+    procfs_register("syscalls", syscall_stats_show);
+}
+
+
+
+/*
+ * void syscall_stats_reset (int32_t pid)
+ * inputs:          the pid of a new process
+ * return value:    none
+ * outputs:         clear the table of the process
+ * notes:           called when the pid is reused by process_create
+ */
+void syscall_stats_reset(int32_t pid){
+    if (pid < 0 || pid >= MAX_PROCESS) return;
+    memset(&process_stats[pid], 0, sizeof(syscall_stats_t));
+}
+
+
+
+/*
+ * void syscall_stats_record (uint32_t num, uint32_t cycles)
+ * inputs:          the system call number and the cycles it took
+ * return value:    none
+ * outputs:         update the global table and the table of the running process
+ * notes:           called by the linkage, num is already checked; halt never
+ *                  returns to the linkage so it is never recorded
+ */
+void syscall_stats_record(uint32_t num, uint32_t cycles){
+    int32_t bucket = hist_bucket(cycles);
+    stat_inc(&global_stats.count[num]);
+    stat_inc(&global_stats.hist[num][bucket]);
+    if (running_process >= 0 && running_process < MAX_PROCESS){
+        stat_inc(&process_stats[running_process].count[num]);
+        stat_inc(&process_stats[running_process].hist[num][bucket]);
+    }
+}
+
+
+
+/*
+ * int32_t show_table (uint8_t* buf, int32_t len, int32_t size, syscall_stats_t* stats)
+ * inputs:          the text buffer, its current length and size, the table to print
+ * return value:    the new length of the text
+ * outputs:         one line per system call that has been used:
+ *                  name, count, then the histogram buckets
+ * notes:
+ */
+static int32_t show_table(uint8_t* buf, int32_t len, int32_t size, syscall_stats_t* stats){
+    int32_t i, j;   // loop index
+    for (i = 1; i <= SYSCALL_NUM; i++){
+        if (stats->count[i] == 0) continue;
+        len = proc_puts(buf, len, size, syscall_names[i]);
+        len = proc_puts(buf, len, size, (int8_t*)"            " + strlen(syscall_names[i]));
+        len = proc_putu(buf, len, size, stats->count[i], 8);
+        len = proc_puts(buf, len, size, (int8_t*)" |");
+        for (j = 0; j < SYSCALL_HIST_BUCKETS; j++){
+            len = proc_puts(buf, len, size, (int8_t*)" ");     // keeps wide numbers apart
+            len = proc_putu(buf, len, size, stats->hist[i][j], 4);
+        }
+        len = proc_puts(buf, len, size, (int8_t*)"\n");
+    }
+    return len;
+}
+
+
+
+/*
+ * int32_t syscall_stats_show (uint8_t* buf, int32_t size)
+ * inputs:          the text buffer and its size
+ * return value:    the length of the text
+ * outputs:         the text of the proc file "syscalls": the global table,
+ *                  then the table of every running process
+ * notes:
+ */
+int32_t syscall_stats_show(uint8_t* buf, int32_t size){
+    int32_t len = 0;
+    int32_t pid;
+    len = proc_puts(buf, len, size, (int8_t*)"name           calls | cycles: <2^7, then one log2 bucket each\n");
+    len = proc_puts(buf, len, size, (int8_t*)"[all]\n");
+    len = show_table(buf, len, size, &global_stats);
+    for (pid = 0; pid < MAX_PROCESS; pid++){
+        if (get_PCB(pid)->pid == -1) continue;
+        len = proc_puts(buf, len, size, (int8_t*)"[pid ");
+        len = proc_putu(buf, len, size, pid, 0);
+        len = proc_puts(buf, len, size, (int8_t*)"]\n");
+        len = show_table(buf, len, size, &process_stats[pid]);
+    }
+    return len;
+}
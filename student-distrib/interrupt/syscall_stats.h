@@ -0,0 +1,29 @@
+/*
+*   Per system call counters and latency histograms, shared by idt_linkage.S
+*/
+
+#ifndef SYSCALL_STATS_H
+#define SYSCALL_STATS_H
+
+#include "../types.h"
+
+#define SYSCALL_NUM             17      // the largest valid system call number
+#define SYSCALL_HIST_BUCKETS    16      // log2 buckets of TSC cycles
+#define SYSCALL_HIST_SHIFT      7       // bucket 0 holds everything below 2^7 cycles
+
+#ifndef ASM
+
+// counters of one process, or of the whole system
+typedef struct syscall_stats{
+    uint32_t count[SYSCALL_NUM + 1];
+    uint32_t hist[SYSCALL_NUM + 1][SYSCALL_HIST_BUCKETS];
+} syscall_stats_t;
+
+void syscall_stats_init();
+void syscall_stats_reset(int32_t pid);
+void syscall_stats_record(uint32_t num, uint32_t cycles);
+int32_t syscall_stats_show(uint8_t* buf, int32_t size);
+
+#endif /* ASM */
+
+#endif
@@ -15,6 +15,11 @@
 #include "filesys.h"
 #include "interrupt/pit.h"
 #include "library/dynamic_allocation.h"
+#include "workqueue.h"
+#include "buddy.h"
+#include "interrupt/syscall_stats.h"
+#include "interrupt/serial.h"
+#include "klog.h"
 
 #define RUN_TESTS
 
@@ -142,10 +147,19 @@ void entry(unsigned long magic, unsigned long addr) {
         ltr(KERNEL_TSS);
     }
 
+    /* Pick the fastest memcpy and memset for this CPU */
+    init_mem_ops();
+
+    /* Init the kernel log, so that everything below can use it */
+    klog_init();
+
     // file system initialization
     boot_blk_t* boot_ptr = (boot_blk_t*)(((module_t*)mbi->mods_addr)->mod_start);
     fs_init(boot_ptr);
 
+    /* Init the physical page frame allocator, before anything needs a frame */
+    buddy_init(mbi);
+
     /* Init the Paging */
     init_paging();
 
@@ -166,6 +180,12 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Init the Interrupt table */
     init_interrupt();
 
+    /* Init the fast system call entry */
+    init_sysenter();
+
+    /* Init the system call statistics and their proc file */
+    syscall_stats_init();
+
     /* Init the PIC */
     i8259_init();
 
@@ -175,6 +195,9 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Init the keyboard */
     keyboard_init();
 
+    /* Init the serial console */
+    serial_init();
+
     /* Enable interrupts */
     /* Do not enable the following until after you have set up your
      * IDT correctly otherwise QEMU will triple fault and simple close
@@ -190,6 +213,9 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Execute the first program ("shell") ... */
     init_PCB();
 
+    /* Create the worker thread for deferred interrupt work */
+    workqueue_init();
+
     /* Init PIR, start scheduling */
     pit_init();
 
@@ -0,0 +1,108 @@
+#include "klog.h"
+#include "procfs.h"
+#include "library/lib.h"
+#include "interrupt/pit.h"
+#include "interrupt/serial.h"
+
+
+/*
+ *  The kernel log.
+ *  Kernel messages go to a ring of records instead of the running terminal,
+ *  the proc file "kmsg" shows them. The ring is single-producer (klog runs
+ *  with interrupts off) and the reader takes no lock: every record carries
+ *  its sequence number, which is cleared while the record is written, so a
+ *  reader notices a record that was overwritten under it and skips it.
+ */
+static klog_record_t klog_ring[KLOG_RECORDS];
+static volatile uint32_t klog_head = 0;     // the number of messages logged so far
+int32_t klog_serial_level = KLOG_INFO;      // messages up to this level are sent to the serial console too
+
+static const int8_t* klog_level_name[] = {"err", "warn", "info", "debug"};
+
+
+
+/*
+ *  void klog_init ()
+ *  DESCRIPTION: register the proc file of the log
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+void klog_init(){
+    procfs_register("kmsg", klog_show);
+}
+
+
+
+/*
+ *  int32_t klog (int32_t level, int8_t* format, ...)
+ *  DESCRIPTION: log a message, the format is the one of printf
+ *  INPUTS:     level -- KLOG_ERR to KLOG_DEBUG
+ *              format -- the message and its parameters
+ *  OUTPUTS:    the record, and the serial console if level is at most klog_serial_level
+ *  RETURN VALUE: the length of the message, it was cut if this is not less than KLOG_TEXT
+ */
+int32_t klog(int32_t level, int8_t* format, ...){
+    uint32_t flags;
+    int32_t len;
+    int32_t* esp = (void*)&format;
+    esp++;
+
+    if (level < KLOG_ERR) level = KLOG_ERR;
+    if (level > KLOG_DEBUG) level = KLOG_DEBUG;
+
+    cli_and_save(flags);
+    klog_record_t* rec = &klog_ring[klog_head & (KLOG_RECORDS - 1)];
+    rec->seq = 0;
+    rec->tick = pit_ticks;
+    rec->level = level;
+    len = vsnprintf(rec->text, KLOG_TEXT, format, esp);
+    rec->seq = ++klog_head;
+    restore_flags(flags);
+
+    if (level <= klog_serial_level){
+        int8_t head[4 + 1] = "<0> ";
+        head[1] = '0' + level;
+        serial_write(head, 4);
+        serial_write(rec->text, strlen(rec->text));
+        serial_write("\n", 1);
+    }
+    return len;
+}
+
+
+
+/*
+ *  int32_t klog_show (uint8_t* buf, int32_t size)
+ *  DESCRIPTION: the text of the proc file "kmsg", one line a message,
+ *               "[seconds.hundredths] level: text", the oldest first
+ *  INPUTS:     the text buffer and its size
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the length of the text
+ */
+int32_t klog_show(uint8_t* buf, int32_t size){
+    klog_record_t rec;
+    uint32_t seq;
+    int32_t len = 0;
+    uint32_t head = klog_head;
+    seq = (head > KLOG_RECORDS) ? head - KLOG_RECORDS + 1 : 1;
+
+    for (; seq <= head; ++seq){
+        klog_record_t* slot = &klog_ring[(seq - 1) & (KLOG_RECORDS - 1)];
+        if (slot->seq != seq) continue;
+        memcpy(&rec, slot, sizeof(rec));
+        if (slot->seq != seq) continue;     // it was reused while copying
+        rec.text[KLOG_TEXT - 1] = '\0';
+
+        len = proc_puts(buf, len, size, (int8_t*)"[");
+        len = proc_putu(buf, len, size, rec.tick / FRE, 5);
+        len = proc_puts(buf, len, size, (rec.tick % FRE < 10) ? (int8_t*)".0" : (int8_t*)".");
+        len = proc_putu(buf, len, size, rec.tick % FRE, 0);
+        len = proc_puts(buf, len, size, (int8_t*)"] ");
+        len = proc_puts(buf, len, size, klog_level_name[rec.level]);
+        len = proc_puts(buf, len, size, (int8_t*)": ");
+        len = proc_puts(buf, len, size, rec.text);
+        len = proc_puts(buf, len, size, (int8_t*)"\n");
+    }
+    return len;
+}
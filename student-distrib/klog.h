@@ -0,0 +1,35 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include "types.h"
+
+
+
+#define KLOG_RECORDS        64          // records kept, must be a power of 2. All of them fit in PROCFS_BUF_SIZE
+#define KLOG_TEXT           80          // the longest message, including the NULL
+
+// levels, lower is more important
+#define KLOG_ERR            0
+#define KLOG_WARN           1
+#define KLOG_INFO           2
+#define KLOG_DEBUG          3
+
+
+
+// one message, seq is 0 while it is being written
+typedef struct klog_record{
+    volatile uint32_t seq;              // 1 + the number of messages before this one
+    uint32_t tick;                      // pit_ticks when it was logged
+    int32_t level;
+    int8_t text[KLOG_TEXT];
+} klog_record_t;
+
+
+
+extern int32_t klog_serial_level;
+
+void klog_init();
+int32_t klog(int32_t level, int8_t* format, ...);
+int32_t klog_show(uint8_t* buf, int32_t size);
+
+#endif
@@ -0,0 +1,120 @@
+#include "kthread.h"
+#include "process.h"
+
+
+kthread_t* running_kthread = NULL;          // the kernel thread currently running, NULL if none
+static kthread_t kthread_array[KTHREAD_MAX];
+static int32_t kthread_next = 0;            // round-robin cursor for kthread_pick
+
+// every kernel thread gets its own kernel stack, they never enter user space
+static uint8_t kthread_stack[KTHREAD_MAX][KTHREAD_STACK_SIZE] __attribute__((aligned (16)));
+
+
+
+/*
+ *  int32_t kthread_create (void (*entry)(void*), void* arg, int32_t (*runnable)(void))
+ *  DESCRIPTION: register a kernel thread, it is started by schedule() the first
+ *               time runnable() reports that it has work
+ *  INPUTS:     entry -- the thread body
+ *              arg -- the argument passed to entry
+ *              runnable -- callback telling the scheduler whether the thread has work
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the index of the thread, or -1 on failure
+ */
+int32_t kthread_create(void (*entry)(void*), void* arg, int32_t (*runnable)(void)){
+    if (entry == NULL || runnable == NULL) return -1;
+
+    int32_t i;  // loop index
+    for (i = 0; i < KTHREAD_MAX; ++i){
+        if (kthread_array[i].state == KTHREAD_UNUSED){
+            kthread_array[i].entry = entry;
+            kthread_array[i].arg = arg;
+            kthread_array[i].runnable = runnable;
+            kthread_array[i].yielded = 0;
+            kthread_array[i].kesp = 0;
+            kthread_array[i].kebp = 0;
+            kthread_array[i].stack_top = (uint32_t)&kthread_stack[i][KTHREAD_STACK_SIZE - 4];
+            kthread_array[i].state = KTHREAD_NEW;
+            return i;
+        }
+    }
+    return -1;  // no free slot
+}
+
+
+
+/*
+ *  int32_t kthread_preempted (kthread_t* ptr)
+ *  DESCRIPTION: check if a thread lost the CPU in the middle of its work
+ *  INPUTS:     ptr -- the thread
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 1 if the thread has been started and did not yield, 0 otherwise
+ */
+int32_t kthread_preempted(kthread_t* ptr){
+    return ptr->state == KTHREAD_READY && ptr->yielded == 0 && ptr != running_kthread;
+}
+
+
+
+/*
+ *  kthread_t* kthread_pick ()
+ *  DESCRIPTION: choose the next kernel thread which has work to do
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: a pointer to the thread, or NULL if no thread wants to run
+ *  NOTES:      called by schedule() with interrupts disabled. A thread which
+ *              was preempted by the PIT instead of yielding is always resumed,
+ *              runnable() only looks at the queue and the item it is running
+ *              has already been taken off it
+ */
+kthread_t* kthread_pick(){
+    int32_t i;  // loop index
+    for (i = 0; i < KTHREAD_MAX; ++i){
+        kthread_t* ptr = &kthread_array[(kthread_next + i) % KTHREAD_MAX];
+        if (kthread_preempted(ptr) || (ptr->state != KTHREAD_UNUSED && ptr->runnable())){
+            kthread_next = (kthread_next + i + 1) % KTHREAD_MAX;
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+
+
+/*
+ *  void kthread_start ()
+ *  DESCRIPTION: the first function executed on a fresh kernel thread stack
+ *  INPUTS:     none
+ *  OUTPUTS:    runs the body of running_kthread
+ *  RETURN VALUE: never returns
+ */
+void kthread_start(){
+    running_kthread->entry(running_kthread->arg);
+
+    // the body is not supposed to return, park the thread forever
+    running_kthread->runnable = NULL;
+    while (1){
+        cli();
+        running_kthread->state = KTHREAD_UNUSED;
+        kthread_yield();
+    }
+}
+
+
+
+/*
+ *  void kthread_yield ()
+ *  DESCRIPTION: give the CPU back to the process interrupted by the kernel thread
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none, returns when schedule() picks this thread again
+ */
+void kthread_yield(){
+    cli();
+    if (running_kthread == NULL){
+        sti();
+        return;
+    }
+    running_kthread->yielded = 1;
+    schedule();
+}
@@ -0,0 +1,41 @@
+#ifndef KTHREAD_H
+#define KTHREAD_H
+
+#include "types.h"
+
+
+
+#define KTHREAD_MAX         2
+#define KTHREAD_STACK_SIZE  0x2000
+
+// kernel thread states
+#define KTHREAD_UNUSED      0       // the slot is free
+#define KTHREAD_NEW         1       // created but never scheduled, no saved context yet
+#define KTHREAD_READY       2       // has been scheduled before, kesp/kebp are valid
+
+
+
+// structure for kernel thread information
+typedef struct kthread{
+    int32_t state;
+    uint32_t kesp;                  // kernel stack pointer saved by schedule()
+    uint32_t kebp;                  // kernel base pointer saved by schedule()
+    uint32_t stack_top;             // initial stack pointer of the thread
+    void (*entry)(void*);           // thread body, should never return
+    void* arg;
+    int32_t (*runnable)(void);      // returns nonzero when the thread has something to do
+    int32_t yielded;                // set while the thread is parked in kthread_yield()
+} kthread_t;
+
+
+
+/* the kernel thread currently on the CPU, NULL when a process is running */
+extern kthread_t* running_kthread;
+
+int32_t kthread_create(void (*entry)(void*), void* arg, int32_t (*runnable)(void));
+int32_t kthread_preempted(kthread_t* ptr);
+kthread_t* kthread_pick();
+void kthread_start();
+void kthread_yield();
+
+#endif
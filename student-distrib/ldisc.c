@@ -0,0 +1,199 @@
+#include "ldisc.h"
+#include "process.h"
+#include "library/lib.h"
+#include "library/pool.h"
+
+
+/*
+ *  The line discipline of the terminals.
+ *  In canonical mode the keyboard handler edits the input line and read
+ *  returns it once Enter is pressed. The handler runs with interrupts on,
+ *  so every edit of the line disables them by itself. A line starts in the BUFFER_SIZE bytes
+ *  of the terminal and moves to a LINE_MAX buffer from long_line_pool when
+ *  it outgrows them. The keys arrive in the interrupt handler, so the
+ *  buffer comes from a pool, which may be used with interrupts off, and not
+ *  from the heap.
+ *  In raw mode every key goes to raw_ring as it is typed and read takes
+ *  whatever is there. The keyboard handler is the only producer and read
+ *  the only consumer, so head and tail need no lock.
+ */
+static pool_t long_line_pool;
+static uint8_t long_lines[TERMINAL_NUM][LINE_MAX];
+
+
+
+/*
+ *  void ldisc_init ()
+ *  DESCRIPTION: give every terminal an empty line in canonical mode
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+void ldisc_init(){
+    int32_t i;      // loop index
+    pool_init(&long_line_pool, (int8_t*)"long lines", long_lines, LINE_MAX, TERMINAL_NUM);
+    for (i = 0; i < TERMINAL_NUM; ++i){
+        terminal_array[i].keyboard_buf = terminal_array[i].line_inline;
+        terminal_array[i].buf_size = BUFFER_SIZE;
+        terminal_array[i].raw_head = 0;
+        terminal_array[i].raw_tail = 0;
+        ldisc_reset(&terminal_array[i]);
+    }
+}
+
+
+
+/*
+ *  int32_t ldisc_raw (terminal_t* terminal)
+ *  DESCRIPTION: check the mode of the program running in a terminal
+ *  INPUTS:     terminal -- the terminal
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 1 if its program asked for raw mode, 0 otherwise
+ */
+int32_t ldisc_raw(terminal_t* terminal){
+    return terminal->pid != -1 && get_PCB(terminal->pid)->tty_mode == TTY_RAW;
+}
+
+
+
+/*
+ *  int32_t ldisc_putc (terminal_t* terminal, uint8_t c)
+ *  DESCRIPTION: append a character to the input line
+ *  INPUTS:     terminal -- the terminal
+ *              c -- the character, '\n' ends the line
+ *  OUTPUTS:    the line moves to a long line buffer when it is full
+ *  RETURN VALUE: 0 on success, -1 if the line is LINE_MAX long, the caller does not echo c then
+ *  SIDE EFFECTS: there is always room for the '\n' and the '\0' after the other characters
+ */
+int32_t ldisc_putc(terminal_t* terminal, uint8_t c){
+    uint32_t flags;
+    cli_and_save(flags);
+    int32_t need = terminal->read_count + ((c == '\n') ? 2 : 3);
+    if (need > terminal->buf_size){
+        uint8_t* line = (terminal->buf_size < LINE_MAX) ? POOL_GET(&long_line_pool, uint8_t) : NULL;
+        if (line == NULL){
+            restore_flags(flags);
+            return -1;
+        }
+        memcpy(line, terminal->keyboard_buf, terminal->read_count);
+        memset(line + terminal->read_count, 0, LINE_MAX - terminal->read_count);
+        terminal->keyboard_buf = line;
+        terminal->buf_size = LINE_MAX;
+    }
+    terminal->keyboard_buf[terminal->read_count++] = c;
+    restore_flags(flags);
+    return 0;
+}
+
+
+
+/*
+ *  void ldisc_erase (terminal_t* terminal)
+ *  DESCRIPTION: remove the last character of the input line
+ *  INPUTS:     terminal -- the terminal
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+void ldisc_erase(terminal_t* terminal){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (terminal->read_count != 0){
+        terminal->read_count--;
+        terminal->keyboard_buf[terminal->read_count] = '\0';
+    }
+    restore_flags(flags);
+}
+
+
+
+/*
+ *  void ldisc_reset (terminal_t* terminal)
+ *  DESCRIPTION: empty the input line
+ *  INPUTS:     terminal -- the terminal
+ *  OUTPUTS:    a long line buffer goes back to the pool
+ *  RETURN VALUE: none
+ */
+void ldisc_reset(terminal_t* terminal){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (terminal->keyboard_buf != terminal->line_inline){
+        pool_put(&long_line_pool, terminal->keyboard_buf);
+        terminal->keyboard_buf = terminal->line_inline;
+        terminal->buf_size = BUFFER_SIZE;
+    }
+    memset(terminal->line_inline, 0, BUFFER_SIZE);
+    terminal->read_count = 0;
+    restore_flags(flags);
+}
+
+
+
+/*
+ *  void ldisc_flush (terminal_t* terminal)
+ *  DESCRIPTION: drop the input line and the raw keys, when the mode changes
+ *  INPUTS:     terminal -- the terminal
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+void ldisc_flush(terminal_t* terminal){
+    ldisc_reset(terminal);
+    terminal->raw_tail = terminal->raw_head;
+}
+
+
+
+/*
+ *  int32_t ldisc_line_len (terminal_t* terminal)
+ *  DESCRIPTION: the length of the finished input line
+ *  INPUTS:     terminal -- the terminal, after Enter was pressed
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the number of characters up to and including the '\n'
+ */
+int32_t ldisc_line_len(terminal_t* terminal){
+    int32_t len;
+    for (len = 0; len < terminal->buf_size && terminal->keyboard_buf[len] != '\n'; ++len);
+    return (len < terminal->buf_size) ? len + 1 : len;
+}
+
+
+
+/*
+ *  int32_t ldisc_raw_put (terminal_t* terminal, uint8_t c)
+ *  DESCRIPTION: queue a key of a raw terminal
+ *  INPUTS:     terminal -- the terminal
+ *              c -- the key
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 0 on success, -1 if the ring is full and the key is dropped
+ */
+int32_t ldisc_raw_put(terminal_t* terminal, uint8_t c){
+    if (terminal->raw_head - terminal->raw_tail == RAW_RING_SIZE) return -1;
+    terminal->raw_ring[terminal->raw_head & (RAW_RING_SIZE - 1)] = c;
+    terminal->raw_head++;
+    return 0;
+}
+
+
+
+/*
+ *  int32_t ldisc_raw_read (terminal_t* terminal, uint8_t* buf, int32_t nbytes)
+ *  DESCRIPTION: take the queued keys of a raw terminal
+ *  INPUTS:     terminal -- the terminal
+ *              buf -- where the keys go
+ *              nbytes -- its size
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the number of keys copied, 0 if there was none
+ *  SIDE EFFECTS: the keys are copied in at most two blocks, the ring wraps once
+ */
+int32_t ldisc_raw_read(terminal_t* terminal, uint8_t* buf, int32_t nbytes){
+    uint32_t tail = terminal->raw_tail;
+    int32_t n = terminal->raw_head - tail;
+    if (n > nbytes) n = nbytes;
+    if (n <= 0) return 0;
+
+    int32_t start = tail & (RAW_RING_SIZE - 1);
+    int32_t first = (n < RAW_RING_SIZE - start) ? n : RAW_RING_SIZE - start;
+    memcpy(buf, terminal->raw_ring + start, first);
+    memcpy(buf + first, terminal->raw_ring, n - first);
+    terminal->raw_tail = tail + n;
+    return n;
+}
@@ -0,0 +1,27 @@
+#ifndef LDISC_H
+#define LDISC_H
+
+#include "types.h"
+#include "terminal.h"
+
+
+
+#define LINE_MAX            1024        // the longest input line, including its '\n'
+
+// tty_mode values
+#define TTY_CANON           0           // read returns whole lines, the keys are echoed and can be edited
+#define TTY_RAW             1           // read returns every key at once, nothing is echoed
+
+
+
+void ldisc_init();
+int32_t ldisc_raw(terminal_t* terminal);
+int32_t ldisc_putc(terminal_t* terminal, uint8_t c);
+void ldisc_erase(terminal_t* terminal);
+void ldisc_reset(terminal_t* terminal);
+void ldisc_flush(terminal_t* terminal);
+int32_t ldisc_line_len(terminal_t* terminal);
+int32_t ldisc_raw_put(terminal_t* terminal, uint8_t c);
+int32_t ldisc_raw_read(terminal_t* terminal, uint8_t* buf, int32_t nbytes);
+
+#endif
@@ -5,6 +5,7 @@
 #include "cursor.h"
 #include "../types.h"
 #include "../terminal.h"
+#include "../vga.h"
 
 
 
@@ -17,6 +18,7 @@
  */
 void enable_cursor(uint8_t cursor_start, uint8_t cursor_end)
 {
+	if (vga_graphics) return;	// the CRTC belongs to mode 13h
 	outb(0x0A, CURSOR_CMD);		// refer to OSDEV, set the cursor
 	outb((inb(CURSOR_DATA) & 0xC0) | cursor_start, CURSOR_DATA);
  
@@ -50,8 +52,8 @@ void disable_cursor()
  */
 void update_cursor(int x, int y)
 {
-	if (running_terminal != display_terminal) return;
-	uint16_t pos = y * NUM_COLS + x;
+	if (running_terminal != display_terminal || vga_graphics) return;
+	uint16_t pos = DISPLAY_START(display_terminal) + y * NUM_COLS + x;
  
 	outb(0x0F, CURSOR_CMD);		// refer to OSDEV, set the cursor
 	outb((uint8_t) (pos & 0xFF), CURSOR_DATA);
@@ -70,7 +72,8 @@ void update_cursor(int x, int y)
  */
 void switch_cursor(int x, int y)
 {
-	uint16_t pos = y * NUM_COLS + x;
+	if (vga_graphics) return;
+	uint16_t pos = DISPLAY_START(display_terminal) + y * NUM_COLS + x;
  
 	outb(0x0F, CURSOR_CMD);		// refer to OSDEV, set the cursor
 	outb((uint8_t) (pos & 0xFF), CURSOR_DATA);
@@ -96,3 +99,22 @@ uint16_t get_cursor_position(void)
     pos |= ((uint16_t)inb(CURSOR_DATA)) << 8;
     return pos;
 }
+
+
+
+/*
+ * void set_display_start ()
+ * inputs:          offset, the cell shown at the top-left corner
+ * return value:    None
+ * outputs:         pan the screen, the rows below the offset are shown
+ * notes:           the cursor position is not relative to the start address,
+ *                  so the callers add the offset to it too
+ */
+void set_display_start(uint16_t offset)
+{
+	if (vga_graphics) return;
+	outb(0x0C, CURSOR_CMD);		// start address high
+	outb((uint8_t) ((offset >> 8) & 0xFF), CURSOR_DATA);
+	outb(0x0D, CURSOR_CMD);		// start address low
+	outb((uint8_t) (offset & 0xFF), CURSOR_DATA);
+}
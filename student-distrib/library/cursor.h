@@ -10,10 +10,14 @@
 #define CURSOR_CMD  0x3D4
 #define CURSOR_DATA 0x3D5
 
+/* the CRTC start address of the screen of terminal t, in cells */
+#define DISPLAY_START(t)    ((t)->tid * RING_CELLS + (t)->origin)
+
 void enable_cursor(uint8_t cursor_start, uint8_t cursor_end);
 void disable_cursor();
 void update_cursor(int x, int y);
 void switch_cursor(int x, int y);
 uint16_t get_cursor_position(void);
+void set_display_start(uint16_t offset);
 
 #endif
@@ -1,11 +1,28 @@
 #include "dynamic_allocation.h"
 #include "lib.h"
 #include "../paging.h"
+#include "../procfs.h"
+#include "../klog.h"
 
 
 
 uint8_t magic_num[4] = {0x7A,0x33,0x9,0x4D};    // for boundary check, chosen randomly by my heart...  
 
+extern int32_t running_process;
+
+#ifdef HEAP_DEBUG
+#define SLAB_GUARD      sizeof(slab_tag_t)  // a small object keeps its size and owner in front of it
+#else
+#define SLAB_GUARD      0
+#endif
+
+#define CHUNK_SIZE(c)   ((c)->size & ~CHUNK_USED)
+#define CHUNK_TAIL(c)   ((uint32_t*)((uint32_t)(c) + CHUNK_SIZE(c) - CHUNK_FOOTER))
+
+static void set_tags(chunk_t* chunk, uint32_t size, uint32_t used);
+static void bin_insert(chunk_t* chunk);
+static int32_t heap_grow(uint32_t need);
+
 
 
 /*
@@ -13,196 +30,633 @@ uint8_t magic_num[4] = {0x7A,0x33,0x9,0x4D};    // for boundary check, chosen ra
  * inputs:          none
  * return value:    none
  * outputs:         initialize the heap area
- * notes:           
+ * notes:           the first HEAP_INIT_SIZE bytes are mapped as one free chunk
  */
 void init_heap(){
     // initialize the heap infomation structure
-    heap_info.first = NULL;
-    heap_info.last = NULL;
+    int32_t i;  // loop index
+    for (i = 0; i < HEAP_BINS; ++i){
+        heap_info.bins[i] = NULL;
+    }
+    heap_info.bin_map = 0;
     heap_info.num_area = 0;
     heap_info.num_byte = 0;
-    heap_info.size_allocator = 12;
+#ifdef HEAP_DEBUG
     heap_info.size_magicnum = 4;
+#else
+    heap_info.size_magicnum = 0;
+#endif
+
+    // nothing is mapped yet, and there is no slab
+    heap_info.brk = HEAP_START;
+    heap_info.slab_low = HEAP_END + 1;
+    heap_info.peak = 0;
+    heap_info.empty_slab = NULL;
+    for (i = 0; i < SLAB_CLASSES; ++i){
+        heap_info.classes[i].size = SLAB_MIN_SIZE << i;
+        heap_info.classes[i].num_obj = (SLAB_SIZE - SLAB_HEADER) / heap_info.classes[i].size;
+        heap_info.classes[i].partial = NULL;
+        heap_info.classes[i].num_slab = 0;
+        heap_info.classes[i].in_use = 0;
+    }
 
-    // set up paging
-    heap_setup();
+    if (heap_grow(HEAP_INIT_SIZE) != 0){
+        klog(KLOG_ERR, "heap: no memory for the kernel heap");
+    }
+    procfs_register("heap", heap_show);
 }
 
 
 
 /*
- * void malloc(int32_t size)
- * inputs:          the size of the desired area
- * return value:    a pointer to the allocated area, NULL on failure 
- * outputs:         allocates an area to the user
+ * int32_t heap_map(uint32_t start, uint32_t size)
+ * inputs:          a page aligned range of the heap which is not mapped
+ * return value:    0 on success and -1 on failure
+ * outputs:         map every page of the range, nothing stays mapped on failure
+ * notes:           updates the high-water mark
+ */
+static int32_t heap_map(uint32_t start, uint32_t size){
+    uint32_t addr;
+    for (addr = start; addr < start + size; addr += HEAP_PAGE){
+        if (kernel_map_page(addr) != 0){
+            while (addr > start){
+                addr -= HEAP_PAGE;
+                kernel_unmap_page(addr);
+            }
+            return -1;
+        }
+    }
+
+    uint32_t mapped = heap_info.brk + size - HEAP_START + HEAP_END + 1 - heap_info.slab_low;
+    if (mapped > heap_info.peak) heap_info.peak = mapped;
+    return 0;
+}
+
+
+
+/*
+ * void heap_unmap(uint32_t start, uint32_t size)
+ * inputs:          a page aligned range of the heap which is mapped
+ * return value:    none
+ * outputs:         unmap the range, its frames go back to the buddy allocator
  * notes:           
  */
-void* malloc(int32_t size){
-    if (size <= 0) return NULL;
+static void heap_unmap(uint32_t start, uint32_t size){
+    uint32_t addr;
+    for (addr = start; addr < start + size; addr += HEAP_PAGE){
+        kernel_unmap_page(addr);
+    }
+}
 
-    // the real size needed
-    int32_t size_real = heap_info.size_allocator + size + heap_info.size_magicnum;
-    int32_t i;  // loop index
 
-    // check if the heap is empty
-    if (heap_info.last == NULL){
-        // allocate from the head of the heap
-        allocator_t* first_ptr = (allocator_t*)HEAP_START;
-        first_ptr->next = NULL;
-        first_ptr->prev = NULL;
-        first_ptr->size = size;
-        
-        // update the heap info
-        heap_info.first = first_ptr;
-        heap_info.last = first_ptr;
-        heap_info.num_area++;
-        heap_info.num_byte += size_real;
-
-        // fill in the magic number
-        uint8_t* boundary_ptr = (uint8_t*)((int32_t)first_ptr + heap_info.size_allocator + size);
-        for (i = 0; i < 4; ++i){
-            *(boundary_ptr + i) = magic_num[i];
-        }
 
-        return (void*)((int32_t)(first_ptr) + heap_info.size_allocator);
+/*
+ * chunk_t* heap_top()
+ * inputs:          none
+ * return value:    the last chunk if it is free, NULL otherwise
+ * outputs:         none
+ * notes:           
+ */
+static chunk_t* heap_top(){
+    if (heap_info.brk == HEAP_START) return NULL;
+    uint32_t tag = *(uint32_t*)(heap_info.brk - CHUNK_FOOTER);
+    if (tag & CHUNK_USED) return NULL;
+    return (chunk_t*)(heap_info.brk - tag);
+}
+
+
+
+/*
+ * void set_tags(chunk_t* chunk, uint32_t size, uint32_t used)
+ * inputs:          the chunk, its size and CHUNK_USED or 0
+ * return value:    none
+ * outputs:         write the boundary tags at both ends of the chunk
+ * notes:           
+ */
+static void set_tags(chunk_t* chunk, uint32_t size, uint32_t used){
+    chunk->size = size | used;
+    *CHUNK_TAIL(chunk) = size | used;
+}
+
+
+
+/*
+ * int32_t bin_of(uint32_t size)
+ * inputs:          the size of a chunk
+ * return value:    the bin of free chunks of that size
+ * outputs:         none
+ * notes:           
+ */
+static int32_t bin_of(uint32_t size){
+    uint32_t msb;
+    asm ("bsrl %1, %0" : "=r" (msb) : "r" (size));
+    if (msb < 5) return 0;
+    return (msb - 5 >= HEAP_BINS) ? HEAP_BINS - 1 : msb - 5;
+}
+
+
+
+/*
+ * void bin_insert(chunk_t* chunk)
+ * inputs:          a free chunk with its tags set
+ * return value:    none
+ * outputs:         put the chunk at the head of its bin
+ * notes:           
+ */
+static void bin_insert(chunk_t* chunk){
+    int32_t bin = bin_of(CHUNK_SIZE(chunk));
+    chunk->prev = NULL;
+    chunk->next = heap_info.bins[bin];
+    if (chunk->next != NULL) chunk->next->prev = chunk;
+    heap_info.bins[bin] = chunk;
+    heap_info.bin_map |= 1 << bin;
+}
+
+
+
+/*
+ * void bin_remove(chunk_t* chunk)
+ * inputs:          a free chunk
+ * return value:    none
+ * outputs:         take the chunk out of its bin
+ * notes:           
+ */
+static void bin_remove(chunk_t* chunk){
+    int32_t bin = bin_of(CHUNK_SIZE(chunk));
+    if (chunk->prev != NULL) chunk->prev->next = chunk->next;
+    else heap_info.bins[bin] = chunk->next;
+    if (chunk->next != NULL) chunk->next->prev = chunk->prev;
+    if (heap_info.bins[bin] == NULL) heap_info.bin_map &= ~(1 << bin);
+}
+
+
+
+/*
+ * void chunk_release(chunk_t* chunk, uint32_t size)
+ * inputs:          a piece of mapped memory below brk which is not in use any more
+ * return value:    none
+ * outputs:         merge it with the free neighbours and put the result in a bin
+ * notes:           neighbours are found through the boundary tags
+ */
+static void chunk_release(chunk_t* chunk, uint32_t size){
+    // the next chunk, if it is free
+    chunk_t* next = (chunk_t*)((uint32_t)chunk + size);
+    if ((uint32_t)next < heap_info.brk && !(next->size & CHUNK_USED)){
+        bin_remove(next);
+        size += CHUNK_SIZE(next);
     }
 
-    
-    // the heap is not empty, try to add the new area to the end of linked list
-    int32_t end = (int32_t)heap_info.last + heap_info.size_allocator + heap_info.last->size + heap_info.size_magicnum - 1;
-    if ((HEAP_END - end) >= size_real){ // we can add it to the end of linked list
-        // new allocator
-        allocator_t* new_last = (allocator_t*)(end + 1);
-        new_last->next = NULL;
-        new_last->prev = heap_info.last;
-        new_last->size = size;
-        new_last->prev->next = new_last;
-
-        // update the heap info
-        heap_info.last = new_last;
-        heap_info.num_area++;
-        heap_info.num_byte += size_real;
-
-        // fill in the magic number
-        uint8_t* boundary_ptr = (uint8_t*)((int32_t)new_last + heap_info.size_allocator + size);
-        for (i = 0; i < 4; ++i){
-            *(boundary_ptr + i) = magic_num[i];
+    // the previous chunk, if it is free
+    if ((uint32_t)chunk > HEAP_START){
+        uint32_t tag = *(uint32_t*)((uint32_t)chunk - CHUNK_FOOTER);
+        if (!(tag & CHUNK_USED)){
+            chunk = (chunk_t*)((uint32_t)chunk - tag);
+            bin_remove(chunk);
+            size += tag;
         }
+    }
 
-        return (void*)((int32_t)(new_last) + heap_info.size_allocator);   
+    set_tags(chunk, size, 0);
+    bin_insert(chunk);
+}
+
+
+
+/*
+ * int32_t heap_grow(uint32_t need)
+ * inputs:          the size of a chunk which does not fit anywhere
+ * return value:    0 on success and -1 if the heap can not grow that much
+ * outputs:         map pages at the end of the chunks, so that the last chunk is
+ *                  free and at least need bytes
+ * notes:           the chunks may grow until they meet the lowest slab
+ */
+static int32_t heap_grow(uint32_t need){
+    chunk_t* top = heap_top();
+    if (top != NULL) need = (CHUNK_SIZE(top) >= need) ? 0 : need - CHUNK_SIZE(top);
+    uint32_t size = (need + HEAP_PAGE - 1) & ~(HEAP_PAGE - 1);
+    if (size == 0) return 0;
+    if (size > heap_info.slab_low - heap_info.brk) return -1;
+
+    uint32_t start = heap_info.brk;
+    if (heap_map(start, size) != 0) return -1;
+    heap_info.brk += size;
+    chunk_release((chunk_t*)start, size);     // merges with the free last chunk
+    return 0;
+}
+
+
+
+/*
+ * void heap_trim()
+ * inputs:          none
+ * return value:    none
+ * outputs:         unmap the free pages at the end of the chunks
+ * notes:           only once at least HEAP_TRIM bytes can go, so a heap which
+ *                  keeps growing and shrinking around the same size is left alone
+ */
+static void heap_trim(){
+    chunk_t* top = heap_top();
+    if (top == NULL) return;
+
+    // keep the page holding the start of the chunk, unless the rest of it is too small to be a chunk
+    uint32_t keep = ((uint32_t)top + HEAP_PAGE - 1) & ~(HEAP_PAGE - 1);
+    if (keep < HEAP_START + HEAP_INIT_SIZE) keep = HEAP_START + HEAP_INIT_SIZE;
+    if (keep > (uint32_t)top && keep - (uint32_t)top < CHUNK_MIN) keep += HEAP_PAGE;
+    if (keep >= heap_info.brk || heap_info.brk - keep < HEAP_TRIM) return;
+
+    bin_remove(top);
+    if (keep > (uint32_t)top){
+        set_tags(top, keep - (uint32_t)top, 0);
+        bin_insert(top);
     }
+    heap_unmap(keep, heap_info.brk - keep);
+    heap_info.brk = keep;
+}
 
-    else{   // search the memory from start of the heap
-        if ((HEAP_END - HEAP_START + 1) - heap_info.num_byte < size_real){  // not enough memory
-            return NULL;
-        }
 
-        // check the memory before the first allocated area
-        if (((int32_t)heap_info.first - HEAP_START) >= size_real){  // enough memory!
-            // allocate from the head of the heap
-            allocator_t* first_ptr = (allocator_t*)HEAP_START;
-            first_ptr->next = heap_info.first;
-            first_ptr->prev = NULL;
-            first_ptr->size = size;
-            first_ptr->next->prev = first_ptr;
-        
-            // update the heap info
-            heap_info.first = first_ptr;
-            heap_info.num_area++;
-            heap_info.num_byte += size_real;
-
-            // fill in the magic number
-            uint8_t* boundary_ptr = (uint8_t*)((int32_t)first_ptr + heap_info.size_allocator + size);
-            for (i = 0; i < 4; ++i){
-                *(boundary_ptr + i) = magic_num[i];
-            }
 
-            return (void*)((int32_t)(first_ptr) + heap_info.size_allocator);
-        }
+/*
+ * uint32_t chunk_need(int32_t size)
+ * inputs:          the size asked for by malloc
+ * return value:    the size of the chunk holding it
+ * outputs:         none
+ * notes:           
+ */
+static uint32_t chunk_need(int32_t size){
+    uint32_t need = size + CHUNK_HEADER + CHUNK_FOOTER + heap_info.size_magicnum;
+    need = (need + CHUNK_ALIGN - 1) & ~(CHUNK_ALIGN - 1);
+    return (need < CHUNK_MIN) ? CHUNK_MIN : need;
+}
+
+
+
+/*
+ * void chunk_split(chunk_t* chunk, uint32_t need)
+ * inputs:          a chunk out of the bins, the size it should keep
+ * return value:    none
+ * outputs:         mark the first need bytes used, the rest becomes a free chunk
+ * notes:           the rest is not split off if it is too small to be a chunk
+ */
+static void chunk_split(chunk_t* chunk, uint32_t need){
+    uint32_t size = CHUNK_SIZE(chunk);
+    if (size - need >= CHUNK_MIN){
+        set_tags(chunk, need, CHUNK_USED);
+        chunk_release((chunk_t*)((uint32_t)chunk + need), size - need);
+    }
+    else{
+        set_tags(chunk, size, CHUNK_USED);
+    }
+}
+
+
+
+/*
+ * chunk_t* chunk_of(void* ptr)
+ * inputs:          a pointer returned by malloc
+ * return value:    its chunk, NULL if it is not an allocated chunk
+ * outputs:         none
+ * notes:           both tags have to agree
+ */
+static chunk_t* chunk_of(void* ptr){
+    if ((uint32_t)ptr < HEAP_START + CHUNK_HEADER || (uint32_t)ptr >= heap_info.brk) return NULL;
+    if ((uint32_t)ptr & (CHUNK_ALIGN - 1)) return NULL;
+
+    chunk_t* chunk = (chunk_t*)((uint32_t)ptr - CHUNK_HEADER);
+    if (!(chunk->size & CHUNK_USED) || CHUNK_SIZE(chunk) < CHUNK_MIN) return NULL;
+    if ((uint32_t)chunk + CHUNK_SIZE(chunk) > heap_info.brk) return NULL;
+    if (*CHUNK_TAIL(chunk) != chunk->size) return NULL;
+    return chunk;
+}
 
-        // walk through the list to find adequate memory, if possible
-        allocator_t* cur_allocator = heap_info.first;
-
-        while (cur_allocator != heap_info.last){
-            int32_t cur_end = (int32_t)cur_allocator + heap_info.size_allocator + cur_allocator->size
-                                 + heap_info.size_magicnum - 1;
-            if (((int32_t)(cur_allocator->next) - cur_end - 1) >= size_real){   // enough memory!
-                // new allocator
-                allocator_t* new_ptr = (allocator_t*)(cur_end + 1);
-                new_ptr->next = cur_allocator->next;
-                new_ptr->prev = cur_allocator;
-                new_ptr->size = size;
-                cur_allocator->next = new_ptr;
-                new_ptr->next->prev = new_ptr;
-
-                // update the heap info
-                heap_info.num_area++;
-                heap_info.num_byte += size_real;
-
-                // fill in the magic number
-                uint8_t* boundary_ptr = (uint8_t*)((int32_t)new_ptr + heap_info.size_allocator + size);
-                for (i = 0; i < 4; ++i){
-                    *(boundary_ptr + i) = magic_num[i];
-                }
-
-                return (void*)((int32_t)(new_ptr) + heap_info.size_allocator);
-            }
 
-            // the current chunk is not big enough
-            cur_allocator = cur_allocator->next;
+
+/*
+ * void chunk_set_req(chunk_t* chunk, int32_t size)
+ * inputs:          an allocated chunk and the size asked for
+ * return value:    none
+ * outputs:         remember the size, and put the magic number behind it in debug mode
+ * notes:           
+ */
+static void chunk_set_req(chunk_t* chunk, int32_t size){
+    chunk->req = size;
+    memcpy((uint8_t*)chunk + CHUNK_HEADER + size, magic_num, heap_info.size_magicnum);
+}
+
+
+
+/*
+ * void malloc_large(int32_t size, uint32_t caller)
+ * inputs:          the size of the desired area and the return address of malloc
+ * return value:    a pointer to the allocated area, NULL on failure 
+ * outputs:         allocates a chunk
+ * notes:           first fit in the bin of the size, else the head of any bigger bin,
+ *                  every chunk there is big enough, else grow the heap
+ */
+static void* malloc_large(int32_t size, uint32_t caller){
+    if (size <= 0) return NULL;
+
+    uint32_t need = chunk_need(size);
+    int32_t bin = bin_of(need);
+    chunk_t* chunk;
+
+    for (chunk = heap_info.bins[bin]; chunk != NULL; chunk = chunk->next){
+        if (CHUNK_SIZE(chunk) >= need) break;
+    }
+    if (chunk == NULL){
+        uint32_t bigger = (bin == HEAP_BINS - 1) ? 0 : heap_info.bin_map & ~((2 << bin) - 1);
+        if (bigger != 0){
+            uint32_t lsb;
+            asm ("bsfl %1, %0" : "=r" (lsb) : "r" (bigger));
+            chunk = heap_info.bins[lsb];
+        }
+        else{
+            // not enough memory, map more pages behind the last chunk
+            if (heap_grow(need) != 0) return NULL;
+            chunk = heap_top();
         }
     }
 
-    // cannot find adequate memory chunk, fail gracefully
-    return NULL;
-};
+    bin_remove(chunk);
+    chunk_split(chunk, need);
+    chunk_set_req(chunk, size);
+#ifdef HEAP_DEBUG
+    chunk->caller = caller;
+    chunk->pid = running_process;
+#endif
+
+    // update the heap info
+    heap_info.num_area++;
+    heap_info.num_byte += CHUNK_SIZE(chunk);
+
+    return (void*)((uint32_t)chunk + CHUNK_HEADER);
+}
 
 
 
 /*
- * int32_t free (void* ptr)
+ * int32_t free_large (void* ptr)
  * inputs:          the pointer to the allocated area
  * return value:    0 on success and -1 on failure
- * outputs:         free the allocated region
+ * outputs:         free a chunk and merge it with its free neighbours
+ * notes:           a big enough free tail of the heap is unmapped
+ */
+static int32_t free_large (void* ptr){
+    chunk_t* chunk = chunk_of(ptr);
+    if (chunk == NULL) return -1;
+
+    // update heap info
+    heap_info.num_area--;
+    heap_info.num_byte -= CHUNK_SIZE(chunk);
+
+    chunk_release(chunk, CHUNK_SIZE(chunk));
+    heap_trim();
+    return 0;
+}
+
+
+
+/*
+ * void* realloc_large(chunk_t* chunk, int32_t new_size)
+ * inputs:          an allocated chunk and the new size
+ * return value:    the pointer to the area if it could be resized where it is, NULL otherwise
+ * outputs:         shrink the chunk, or grow it into the free chunk behind it
  * notes:           
  */
-int32_t free (void* ptr){
-    if ((int32_t)(ptr) < (HEAP_START + heap_info.size_allocator) || 
-                        (int32_t)(ptr) > (HEAP_END - heap_info.size_magicnum)){
-        return -1;
+static void* realloc_large(chunk_t* chunk, int32_t new_size){
+    uint32_t need = chunk_need(new_size);
+    uint32_t size = CHUNK_SIZE(chunk);
+    void* ptr = (void*)((uint32_t)chunk + CHUNK_HEADER);
+
+    if (need > size){
+        chunk_t* next = (chunk_t*)((uint32_t)chunk + size);
+        if ((uint32_t)next >= heap_info.brk || (next->size & CHUNK_USED)) return NULL;
+        if (size + CHUNK_SIZE(next) < need) return NULL;
+        bin_remove(next);
+        set_tags(chunk, size + CHUNK_SIZE(next), CHUNK_USED);
     }
 
-    allocator_t* cur_allocator = (allocator_t*)((int32_t)(ptr) - heap_info.size_allocator);
-    allocator_t* next_allocator = cur_allocator->next; 
-    allocator_t* prev_allocator = cur_allocator->prev;
+    chunk_split(chunk, need);
+    chunk_set_req(chunk, new_size);
+    heap_info.num_byte += CHUNK_SIZE(chunk) - size;
+    return ptr;
+}
 
-    if ((next_allocator == NULL) && (prev_allocator == NULL)){  // this chunk is the only allocated area
-        heap_info.first = NULL;
-        heap_info.last = NULL;
-        heap_info.num_area = 0;
-        heap_info.num_byte = 0;
-        return 0;
+
+
+/*
+ * int32_t slab_class_of(int32_t size)
+ * inputs:          the size of an object, including the guard bytes
+ * return value:    the smallest class holding it, SLAB_CLASSES if it is too big
+ * outputs:         none
+ * notes:           
+ */
+static int32_t slab_class_of(int32_t size){
+    int32_t class = 0;
+    while (class < SLAB_CLASSES && heap_info.classes[class].size < size) ++class;
+    return class;
+}
+
+
+
+/*
+ * slab_t* slab_of(void* ptr)
+ * inputs:          a pointer returned by malloc
+ * return value:    the slab holding it, NULL if it is not a small object
+ * outputs:         none
+ * notes:           the slab is found by rounding down, then the pointer has to be
+ *                  exactly at the start of one of its objects
+ */
+static slab_t* slab_of(void* ptr){
+    if ((uint32_t)ptr < heap_info.slab_low || (uint32_t)ptr > HEAP_END) return NULL;
+
+    slab_t* slab = (slab_t*)((uint32_t)ptr & ~(SLAB_SIZE - 1));
+    if (slab->magic != SLAB_MAGIC || slab->class >= SLAB_CLASSES) return NULL;
+
+    slab_class_t* cls = &heap_info.classes[slab->class];
+    int32_t offset = (int32_t)ptr - SLAB_GUARD - ((int32_t)slab + SLAB_HEADER);
+    if (offset < 0 || offset % cls->size != 0 || offset / cls->size >= cls->num_obj) return NULL;
+    return slab;
+}
+
+
+
+/*
+ * slab_t* new_slab(int32_t class)
+ * inputs:          the size class
+ * return value:    a slab full of free objects, NULL if the heap is full
+ * outputs:         reuse an empty slab, or map a new one below the lowest slab
+ * notes:           the new slab becomes the first partial slab of the class
+ */
+static slab_t* new_slab(int32_t class){
+    slab_t* slab;
+    slab_class_t* cls = &heap_info.classes[class];
+
+    if (heap_info.empty_slab != NULL){
+        slab = heap_info.empty_slab;
+        heap_info.empty_slab = slab->next;
+    }
+    else{
+        // the slabs grow down until they meet the chunks
+        if (heap_info.slab_low - heap_info.brk < SLAB_SIZE) return NULL;
+        if (heap_map(heap_info.slab_low - SLAB_SIZE, SLAB_SIZE) != 0) return NULL;
+        heap_info.slab_low -= SLAB_SIZE;
+        slab = (slab_t*)heap_info.slab_low;
+        slab->magic = SLAB_MAGIC;
     }
 
-    if (next_allocator == NULL){        // this chunk is at the end of the linked list
-        prev_allocator->next = NULL;
-        heap_info.last = prev_allocator;
+    // link all the objects into the free list
+    int32_t i;  // loop index
+    uint8_t* obj = (uint8_t*)slab + SLAB_HEADER;
+    for (i = 0; i < cls->num_obj - 1; ++i){
+        *(void**)(obj + i * cls->size) = obj + (i + 1) * cls->size;
     }
-    else if (prev_allocator == NULL){   // this chunk is at the start of the linked list
-        next_allocator->prev = NULL;
-        heap_info.first = next_allocator;
+    *(void**)(obj + i * cls->size) = NULL;
+    slab->free_list = obj;
+    slab->class = class;
+    slab->in_use = 0;
+
+    slab->prev = NULL;
+    slab->next = cls->partial;
+    if (cls->partial != NULL) cls->partial->prev = slab;
+    cls->partial = slab;
+    cls->num_slab++;
+    return slab;
+}
+
+
+
+/*
+ * void* slab_alloc(int32_t size, uint32_t caller)
+ * inputs:          the size of the desired area, at most SLAB_MAX_SIZE with the guard,
+ *                  and the return address of malloc
+ * return value:    a pointer to the allocated object, NULL on failure
+ * outputs:         take the first free object of the first partial slab of the class
+ * notes:           O(1)
+ */
+static void* slab_alloc(int32_t size, uint32_t caller){
+    int32_t class = slab_class_of(size + SLAB_GUARD + heap_info.size_magicnum);
+    slab_class_t* cls = &heap_info.classes[class];
+
+    slab_t* slab = cls->partial;
+    if (slab == NULL){
+        slab = new_slab(class);
+        if (slab == NULL) return NULL;
     }
-    else{                               // this chunk is in the middle of the linked list
-        next_allocator->prev = prev_allocator;
-        prev_allocator->next = next_allocator;
+
+    uint8_t* obj = slab->free_list;
+    slab->free_list = *(void**)obj;
+    slab->in_use++;
+    cls->in_use++;
+    if (slab->free_list == NULL){   // the slab is full now, it is the head of the partial list
+        cls->partial = slab->next;
+        if (slab->next != NULL) slab->next->prev = NULL;
     }
 
-    // update heap info
-    heap_info.num_area--;
-    heap_info.num_byte -= (heap_info.size_allocator + cur_allocator->size + heap_info.size_magicnum);
+#ifdef HEAP_DEBUG
+    slab_tag_t* tag = (slab_tag_t*)obj;
+    tag->req = size;
+    tag->caller = caller;
+    tag->pid = running_process;
+    memcpy(obj + SLAB_GUARD + size, magic_num, heap_info.size_magicnum);
+#endif
+    return obj + SLAB_GUARD;
+}
 
+
+
+/*
+ * int32_t slab_free(slab_t* slab, void* ptr)
+ * inputs:          the slab and the object in it
+ * return value:    0 on success and -1 on failure
+ * outputs:         put the object back to the free list of its slab
+ * notes:           O(1), a slab with no object in use goes back to the empty slabs
+ */
+static int32_t slab_free(slab_t* slab, void* ptr){
+    slab_class_t* cls = &heap_info.classes[slab->class];
+    uint8_t* obj = (uint8_t*)ptr - SLAB_GUARD;
+    if (slab->in_use == 0) return -1;
+#ifdef HEAP_DEBUG
+    // a free object starts with the free list link, which is never a valid size
+    if (*(int32_t*)obj <= 0 || *(int32_t*)obj > cls->size) return -1;
+#endif
+
+    int32_t was_full = (slab->free_list == NULL);
+    *(void**)obj = slab->free_list;
+    slab->free_list = obj;
+    slab->in_use--;
+    cls->in_use--;
+
+    if (was_full){  // the slab has a free object again
+        slab->prev = NULL;
+        slab->next = cls->partial;
+        if (cls->partial != NULL) cls->partial->prev = slab;
+        cls->partial = slab;
+    }
+
+    if (slab->in_use == 0){     // give the slab to any class which needs one
+        if (slab->prev != NULL) slab->prev->next = slab->next;
+        else cls->partial = slab->next;
+        if (slab->next != NULL) slab->next->prev = slab->prev;
+        cls->num_slab--;
+        if ((uint32_t)slab == heap_info.slab_low){
+            // the lowest slab is unmapped, so the chunks can grow into its place
+            heap_info.slab_low += SLAB_SIZE;
+            heap_unmap((uint32_t)slab, SLAB_SIZE);
+        }
+        else{
+            slab->next = heap_info.empty_slab;
+            heap_info.empty_slab = slab;
+        }
+    }
     return 0;
-};
+}
+
+
+
+/*
+ * void* heap_alloc(int32_t size, uint32_t caller)
+ * inputs:          the size of the desired area and the call site it is for
+ * return value:    a pointer to the allocated area, NULL on failure 
+ * outputs:         allocates an area
+ * notes:           small areas come from the slabs, large ones from the chunks
+ */
+static void* heap_alloc(int32_t size, uint32_t caller){
+    if (size <= 0) return NULL;
+    if (size + SLAB_GUARD + heap_info.size_magicnum <= SLAB_MAX_SIZE){
+        void* ptr = slab_alloc(size, caller);
+        if (ptr != NULL) return ptr;
+        // no room for one more slab, a free chunk may still be big enough
+    }
+    return malloc_large(size, caller);
+}
+
+
+
+/*
+ * void malloc(int32_t size)
+ * inputs:          the size of the desired area
+ * return value:    a pointer to the allocated area, NULL on failure 
+ * outputs:         allocates an area to the user
+ * notes:           the caller is remembered in debug mode
+ */
+void* malloc(int32_t size){
+    return heap_alloc(size, (uint32_t)__builtin_return_address(0));
+}
+
+
+
+/*
+ * int32_t free (void* ptr)
+ * inputs:          the pointer to the allocated area
+ * return value:    0 on success and -1 on failure
+ * outputs:         free the allocated region
+ * notes:           
+ */
+int32_t free (void* ptr){
+    slab_t* slab = slab_of(ptr);
+    if (slab != NULL) return slab_free(slab, ptr);
+    return free_large(ptr);
+}
 
 
 
@@ -211,19 +665,28 @@ int32_t free (void* ptr){
  * inputs:          the pointer to the allocated area
  * return value:    0 on success and -1 on failure
  * outputs:         validate the allocated chunk
- * notes:           
+ * notes:           the magic number is only there with HEAP_DEBUG
  */
 int32_t validate(void* ptr){
-    if ((int32_t)(ptr) < (HEAP_START + heap_info.size_allocator) || 
-                        (int32_t)(ptr) > (HEAP_END - heap_info.size_magicnum)){
-        return -1;
+    int32_t i;  // loop index
+    slab_t* slab = slab_of(ptr);
+    if (slab != NULL){
+        if (slab->in_use == 0) return -1;
+#ifdef HEAP_DEBUG
+        int32_t size = *(int32_t*)(ptr - SLAB_GUARD);
+        if (size <= 0 || size > heap_info.classes[slab->class].size) return -1;     // a free object
+        for (i = 0; i < heap_info.size_magicnum; ++i){
+            if (magic_num[i] != *((uint8_t*)ptr + size + i)) return -1;
+        }
+#endif
+        return 0;
     }
 
-    allocator_t* cur_allocator = (allocator_t*)((int32_t)(ptr) - heap_info.size_allocator);
-    uint8_t* boundary = (uint8_t*)((int32_t)(ptr) + cur_allocator->size);   // pointer to the magic number
+    chunk_t* chunk = chunk_of(ptr);
+    if (chunk == NULL) return -1;
 
-    int32_t i;  // loop index
-    for (i = 0; i < 4; ++i){
+    uint8_t* boundary = (uint8_t*)ptr + chunk->req;   // pointer to the magic number
+    for (i = 0; i < heap_info.size_magicnum; ++i){
         if (magic_num[i] != *(boundary + i)){
             return -1;
         }
@@ -234,6 +697,195 @@ int32_t validate(void* ptr){
 
 
 
+/*
+ * void heap_free_space(uint32_t* total, uint32_t* largest)
+ * inputs:          where to put the results
+ * return value:    none
+ * outputs:         the bytes in all the free chunks, and the size of the biggest one
+ * notes:           memory which is not mapped does not count
+ */
+static void heap_free_space(uint32_t* total, uint32_t* largest){
+    int32_t i;  // loop index
+    chunk_t* chunk;
+    *total = 0;
+    *largest = 0;
+    for (i = 0; i < HEAP_BINS; ++i){
+        for (chunk = heap_info.bins[i]; chunk != NULL; chunk = chunk->next){
+            *total += CHUNK_SIZE(chunk);
+            if (CHUNK_SIZE(chunk) > *largest) *largest = CHUNK_SIZE(chunk);
+        }
+    }
+}
+
+
+
+/*
+ * uint32_t heap_fragmentation(uint32_t total, uint32_t largest)
+ * inputs:          the free bytes and the biggest free chunk
+ * return value:    0 if all the free memory is one chunk, close to 100 if it is
+ *                  spread over many small gaps
+ * outputs:         none
+ * notes:           
+ */
+static uint32_t heap_fragmentation(uint32_t total, uint32_t largest){
+    if (total == 0) return 0;
+    while (total > 0x1000000){  // keep largest * 100 in 32 bits
+        total >>= 1;
+        largest >>= 1;
+    }
+    return 100 - largest * 100 / total;
+}
+
+
+
+#ifdef HEAP_DEBUG
+/*
+ * void heap_walk(void (*visit)(void*, int32_t, uint32_t, int32_t))
+ * inputs:          called with the pointer, the size, the caller and the pid
+ *                  of every allocated area
+ * return value:    none
+ * outputs:         none
+ * notes:           a free small object starts with its free list link, which
+ *                  is never a valid size
+ */
+static void heap_walk(void (*visit)(void*, int32_t, uint32_t, int32_t)){
+    int32_t i;  // loop index
+    chunk_t* chunk = (chunk_t*)HEAP_START;
+    while ((uint32_t)chunk < heap_info.brk){
+        if (chunk->size & CHUNK_USED){
+            visit((uint8_t*)chunk + CHUNK_HEADER, chunk->req, chunk->caller, chunk->pid);
+        }
+        chunk = (chunk_t*)((uint32_t)chunk + CHUNK_SIZE(chunk));
+    }
+
+    uint32_t addr;
+    for (addr = heap_info.slab_low; addr < HEAP_END; addr += SLAB_SIZE){
+        slab_t* slab = (slab_t*)addr;
+        if (slab->magic != SLAB_MAGIC || slab->in_use == 0) continue;
+        slab_class_t* cls = &heap_info.classes[slab->class];
+        for (i = 0; i < cls->num_obj; ++i){
+            slab_tag_t* tag = (slab_tag_t*)((uint8_t*)slab + SLAB_HEADER + i * cls->size);
+            if (tag->req <= 0 || tag->req > cls->size) continue;
+            visit((uint8_t*)tag + SLAB_GUARD, tag->req, tag->caller, tag->pid);
+        }
+    }
+}
+
+
+
+static int32_t leak_pid;        // the process heap_leak_report is looking for
+static int32_t leak_num;
+
+/* log one area of leak_pid */
+static void leak_visit(void* ptr, int32_t req, uint32_t caller, int32_t pid){
+    if (pid != leak_pid) return;
+    klog(KLOG_WARN, "heap: leak of %d bytes at 0x%x, allocated by 0x%x", req, ptr, caller);
+    leak_num++;
+}
+
+
+
+static uint32_t site_caller[HEAP_SITES];    // the call sites seen by heap_show, 0 for all the others
+static int32_t site_count[HEAP_SITES];
+static int32_t site_bytes[HEAP_SITES];
+static int32_t site_num;
+
+/* count one area for its call site */
+static void site_visit(void* ptr, int32_t req, uint32_t caller, int32_t pid){
+    int32_t i;  // loop index
+    for (i = 0; i < site_num && site_caller[i] != caller; ++i);
+    if (i == site_num && site_num >= HEAP_SITES - 1){
+        // the table is full, the last line takes the rest
+        caller = 0;
+        for (i = 0; i < site_num && site_caller[i] != caller; ++i);
+    }
+    if (i == site_num){
+        site_caller[i] = caller;
+        site_count[i] = 0;
+        site_bytes[i] = 0;
+        site_num++;
+    }
+    site_count[i]++;
+    site_bytes[i] += req;
+}
+#endif
+
+
+
+/*
+ * int32_t heap_leak_report(int32_t pid)
+ * inputs:          a process which is exiting
+ * return value:    the number of areas it still owns
+ * outputs:         log every area allocated while pid was running which is still in use
+ * notes:           needs HEAP_DEBUG, otherwise nothing is known about the owners and 0 is returned
+ */
+int32_t heap_leak_report(int32_t pid){
+#ifdef HEAP_DEBUG
+    leak_pid = pid;
+    leak_num = 0;
+    heap_walk(leak_visit);
+    if (leak_num != 0) klog(KLOG_WARN, "heap: process %d exits with %d areas in the heap", pid, leak_num);
+    return leak_num;
+#else
+    return 0;
+#endif
+}
+
+
+
+/*
+ * int32_t heap_show(uint8_t* buf, int32_t size)
+ * inputs:          the text buffer and its size
+ * return value:    the length of the text
+ * outputs:         the text of the proc file "heap": mapped memory, free space and
+ *                  fragmentation, the slab classes, and the call sites in debug mode
+ * notes:           
+ */
+int32_t heap_show(uint8_t* buf, int32_t size){
+    int32_t i;  // loop index
+    int32_t len = 0;
+    uint32_t free_total, free_largest;
+    heap_free_space(&free_total, &free_largest);
+
+    len = proc_puts(buf, len, size, (int8_t*)"mapped:   ");
+    len = proc_putu(buf, len, size, heap_info.brk - HEAP_START + HEAP_END + 1 - heap_info.slab_low, 10);
+    len = proc_puts(buf, len, size, (int8_t*)"  peak ");
+    len = proc_putu(buf, len, size, heap_info.peak, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\nchunks:   ");
+    len = proc_putu(buf, len, size, heap_info.num_area, 10);
+    len = proc_puts(buf, len, size, (int8_t*)"  bytes ");
+    len = proc_putu(buf, len, size, heap_info.num_byte, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"\nfree:     ");
+    len = proc_putu(buf, len, size, free_total, 10);
+    len = proc_puts(buf, len, size, (int8_t*)"  largest ");
+    len = proc_putu(buf, len, size, free_largest, 0);
+    len = proc_puts(buf, len, size, (int8_t*)"  fragmentation ");
+    len = proc_putu(buf, len, size, heap_fragmentation(free_total, free_largest), 0);
+    len = proc_puts(buf, len, size, (int8_t*)"%\n\nclass  slabs  in use\n");
+    for (i = 0; i < SLAB_CLASSES; ++i){
+        len = proc_putu(buf, len, size, heap_info.classes[i].size, 5);
+        len = proc_putu(buf, len, size, heap_info.classes[i].num_slab, 7);
+        len = proc_putu(buf, len, size, heap_info.classes[i].in_use, 8);
+        len = proc_puts(buf, len, size, (int8_t*)"\n");
+    }
+
+#ifdef HEAP_DEBUG
+    site_num = 0;
+    heap_walk(site_visit);
+    len = proc_puts(buf, len, size, (int8_t*)"\ncaller      areas     bytes\n");
+    for (i = 0; i < site_num; ++i){
+        if (site_caller[i] == 0) len = proc_puts(buf, len, size, (int8_t*)"others    ");
+        else len = proc_putx(buf, len, size, site_caller[i]);
+        len = proc_putu(buf, len, size, site_count[i], 8);
+        len = proc_putu(buf, len, size, site_bytes[i], 10);
+        len = proc_puts(buf, len, size, (int8_t*)"\n");
+    }
+#endif
+    return len;
+}
+
+
+
 /*
  * void print_heap_info()
  * inputs:          none
@@ -242,19 +894,32 @@ int32_t validate(void* ptr){
  * notes:           
  */
 void print_heap_info(){
+    int32_t i;  // loop index
+    for (i = 0; i < SLAB_CLASSES; ++i){
+        if (heap_info.classes[i].num_slab == 0) continue;
+        printf("Class %d bytes: %d slabs, %d objects in use.\n", heap_info.classes[i].size,
+                heap_info.classes[i].num_slab, heap_info.classes[i].in_use);
+    }
+
     printf("Number of allocated memory chunks:  %d\n", heap_info.num_area);
     printf("Number of allocated memory size:    %d\n", heap_info.num_byte);
-
-    if (heap_info.first == NULL) return;    // check if the list is empty
-
-    int32_t i = 0;  // loop index
-    allocator_t* cur_allocator = heap_info.first;
-
-    while (cur_allocator != NULL) { // walk through the list
-        int32_t cur_address = (int32_t)(cur_allocator) + heap_info.size_allocator;
-        printf("Chunk %d, %d bytes, starting address: %d.\n", i, cur_allocator->size, cur_address);
-        cur_allocator = cur_allocator->next;
-        ++i;
+    printf("Mapped: %d bytes of chunks, %d bytes of slabs, at most %d bytes.\n",
+            heap_info.brk - HEAP_START, HEAP_END + 1 - heap_info.slab_low, heap_info.peak);
+    uint32_t free_total, free_largest;
+    heap_free_space(&free_total, &free_largest);
+    printf("Free: %d bytes, the largest gap %d bytes, %d%% fragmented.\n",
+            free_total, free_largest, heap_fragmentation(free_total, free_largest));
+
+    // walk through all the chunks
+    i = 0;
+    chunk_t* chunk = (chunk_t*)HEAP_START;
+    while ((uint32_t)chunk < heap_info.brk){
+        if (chunk->size & CHUNK_USED){
+            int32_t cur_address = (int32_t)(chunk) + CHUNK_HEADER;
+            printf("Chunk %d, %d bytes, starting address: %d.\n", i, chunk->req, cur_address);
+            ++i;
+        }
+        chunk = (chunk_t*)((uint32_t)chunk + CHUNK_SIZE(chunk));
     }
 }
 
@@ -265,25 +930,42 @@ void print_heap_info(){
  * inputs:          pointer
  * return value:    none
  * outputs:         reallocate
- * notes:           
+ * notes:           a small object stays where it is as long as its class is big enough,
+ *                  a chunk is resized where it is if the memory behind it is free
  */
 void* realloc(void* ptr, int32_t new_size){
-    if ((int32_t)(ptr) < (HEAP_START + heap_info.size_allocator) || 
-                        (int32_t)(ptr) > (HEAP_END - heap_info.size_magicnum)){
-        return NULL;
+    int32_t old_size;
+    slab_t* slab = slab_of(ptr);
+    if (new_size <= 0) return NULL;
+
+    if (slab != NULL){
+        if (slab->in_use == 0) return NULL;
+        int32_t room = heap_info.classes[slab->class].size - SLAB_GUARD - heap_info.size_magicnum;
+#ifdef HEAP_DEBUG
+        old_size = *(int32_t*)(ptr - SLAB_GUARD);
+#else
+        old_size = room;
+#endif
+        if (new_size <= room){
+#ifdef HEAP_DEBUG
+            *(int32_t*)(ptr - SLAB_GUARD) = new_size;
+            memcpy(ptr + new_size, magic_num, heap_info.size_magicnum);
+#endif
+            return ptr;
+        }
+    }
+    else{
+        chunk_t* chunk = chunk_of(ptr);
+        if (chunk == NULL) return NULL;
+        old_size = chunk->req;
+        if (realloc_large(chunk, new_size) != NULL) return ptr;
     }
 
-    // get the current allocator
-    allocator_t* cur_allocator = (allocator_t*)((int32_t)(ptr) - heap_info.size_allocator);
-
-    // allocate new memory chunk
-    void* new_ptr = malloc(new_size);
+    // allocate new memory chunk, it belongs to the caller of realloc
+    void* new_ptr = heap_alloc(new_size, (uint32_t)__builtin_return_address(0));
     if (new_ptr == NULL) return NULL;   // return NULL on failure
 
-    int32_t i;  // loop index
-    for(i = 0; i < cur_allocator->size && i < new_size; ++i){
-        *((uint8_t*)(new_ptr + i)) = *((uint8_t*)(ptr + i));
-    }
+    memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
 
     free(ptr);  // free the old memory chunk
 
@@ -2,27 +2,107 @@
 
 
 
-/* I choose 36 MB -- 40 MB to be the heap region */
+/*
+ * the heap may use 36 MB -- 128 MB (the user program), but only the pages in
+ * use are mapped: the chunks grow up from HEAP_START, the slabs grow down from
+ * HEAP_END, and both take their pages from the buddy allocator on demand
+ */
 #define HEAP_START      0x2400000
-#define HEAP_END        0x27FFFFF
+#define HEAP_END        0x7FFFFFF
+#define HEAP_PAGE       0x1000
+#define HEAP_INIT_SIZE  0x10000     // mapped by init_heap, never given back
+#define HEAP_TRIM       0x10000     // a free tail of the chunks is unmapped once it is this big
 
+/*
+ * uncomment to guard every chunk with a magic number, checked by validate(),
+ * and to tag every allocation with its caller and process for the leak report
+ */
+// #define HEAP_DEBUG
+#define HEAP_SITES      16          // call sites listed in the proc file "heap"
 
+/*
+ * small requests are served from slabs: 8 kB aligned pages mapped below the
+ * lowest slab, each holding objects of a single size class
+ */
+#define SLAB_SIZE       0x2000
+#define SLAB_HEADER     32          // objects start after the slab header
+#define SLAB_MAGIC      0x51AB5A1B
+#define SLAB_CLASSES    8           // 16, 32, ..., 2048 bytes
+#define SLAB_MIN_SIZE   16
+#define SLAB_MAX_SIZE   (SLAB_MIN_SIZE << (SLAB_CLASSES - 1))
 
-/* the start of each allocated area is an allocator structure */
-typedef struct allocator{
-    struct allocator* next;     // the pointer to the next allocated area, if no such area, set to NULL
-    struct allocator* prev;     // the pointer to the previous allocated area, if no such area, set to NULL
-    int32_t size;               // the size of the allocated area
-}allocator_t;
+
+
+/*
+ * large requests are served from chunks with boundary tags: the size of a
+ * chunk is stored at both of its ends, so free() can find and merge the
+ * neighbours in O(1). Free chunks are kept in HEAP_BINS lists by size.
+ */
+#ifdef HEAP_DEBUG
+#define CHUNK_HEADER    16          // size and flags, the requested size, the caller and the pid
+#define CHUNK_MIN       32          // a free chunk must have room for its links
+#else
+#define CHUNK_HEADER    8           // size and flags, then the requested size
+#define CHUNK_MIN       24          // a free chunk must have room for its links
+#endif
+#define CHUNK_FOOTER    4           // a copy of size and flags
+#define CHUNK_ALIGN     8
+#define CHUNK_USED      0x1         // flag in the size word
+#define HEAP_BINS       16          // bin i holds [2^(i+5), 2^(i+6)) bytes, the last bin anything bigger
+
+/* the start of each chunk, next and prev are only valid while the chunk is free */
+typedef struct chunk{
+    uint32_t size;              // the size of the whole chunk, the low bit is CHUNK_USED
+    int32_t req;                // the size asked for by malloc
+#ifdef HEAP_DEBUG
+    uint32_t caller;            // the return address of the malloc call
+    int32_t pid;                // the running process at that time, -1 for the kernel
+#endif
+    struct chunk* next;         // the next free chunk in the same bin
+    struct chunk* prev;         // the previous free chunk in the same bin
+}chunk_t;
+
+#ifdef HEAP_DEBUG
+/* in front of each small object */
+typedef struct slab_tag{
+    int32_t req;                // the size asked for by malloc, a free object has its free list link here
+    uint32_t caller;
+    int32_t pid;
+    uint32_t reserved;          // keeps the object 16 bytes aligned
+}slab_tag_t;
+#endif
+
+/* the start of each slab, the rest of the slab is cut into objects */
+typedef struct slab{
+    struct slab* next;          // the next slab of the same class with free objects, or the next empty slab
+    struct slab* prev;          // the previous slab of the same class with free objects
+    void* free_list;            // free objects of this slab, linked through their first word
+    uint16_t class;             // the size class
+    uint16_t in_use;            // the number of allocated objects
+    uint32_t magic;             // SLAB_MAGIC
+}slab_t;
+
+/* one size class */
+typedef struct slab_class{
+    int32_t size;               // the size of one object
+    int32_t num_obj;            // the number of objects in one slab
+    slab_t* partial;            // slabs which still have free objects
+    int32_t num_slab;           // the number of slabs owned by this class
+    int32_t in_use;             // the number of allocated objects
+}slab_class_t;
 
 /* the infomation of the heap area */
 typedef struct {
-    allocator_t* first;
-    allocator_t* last;
-    int32_t num_area;
-    int32_t num_byte;
-    int32_t size_allocator;
+    chunk_t* bins[HEAP_BINS];   // free chunks by size
+    uint32_t bin_map;           // bit i is set if bins[i] is not empty
+    int32_t num_area;           // the number of allocated chunks
+    int32_t num_byte;           // the number of bytes in allocated chunks
     int32_t size_magicnum;
+    uint32_t brk;               // the end of the chunks, [HEAP_START, brk) is mapped
+    uint32_t slab_low;          // the lowest slab, [slab_low, HEAP_END] is mapped
+    uint32_t peak;              // the most bytes ever mapped at once
+    slab_t* empty_slab;         // slabs with no object in use, ready for any class
+    slab_class_t classes[SLAB_CLASSES];
 } heap_info_t;
 
 
@@ -39,3 +119,5 @@ int32_t free (void* ptr);
 int32_t validate(void* ptr);
 void print_heap_info();
 void* realloc(void* ptr, int32_t new_size);
+int32_t heap_leak_report(int32_t pid);
+int32_t heap_show(uint8_t* buf, int32_t size);
@@ -6,9 +6,28 @@
 #include "../terminal.h"
 #include "../paging.h"
 #include "../process.h"
+#include "../interrupt/serial.h"
 
 
 char* video_mem = (char *)VIDEO;
+uint32_t mem_features = 0;          // MEM_ERMS, MEM_SSE2, set by init_mem_ops
+static uint8_t sse_save[512] __attribute__((aligned(16)));     // the fxsave area of sse_begin
+
+#define PRINTF_BUF  256             // printf writes to the screen whenever this much text is formatted
+
+/* where the formatter shared by printf and snprintf puts the text */
+typedef struct fmt_out {
+    int8_t* buf;
+    int32_t size;                   // size of buf, including the NULL
+    int32_t len;                    // characters in buf
+    int32_t total;                  // characters of the whole text
+    int32_t flush;                  // 1 if a full buf goes to the screen (printf), 0 if the text is cut (snprintf)
+} fmt_out_t;
+
+static void scroll_up(terminal_t* t, uint8_t attr, int32_t lines);
+
+/* the cell (x, y) of the screen of terminal t, every terminal has its own part of video memory */
+#define SCREEN_CELL(t, x, y)    ((uint16_t*)(t)->video_mem_buf + (t)->origin + (y) * NUM_COLS + (x))
 
 
 /* void init_colorScheme(void);
@@ -26,47 +45,63 @@ void init_colorScheme(void){
  * Return Value: none
  * Function: Clears video memory */
 void clear(void) {
-    terminal_video();
-    int32_t i;
-    for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = color_scheme[display_terminal->tid];
-    }
+    uint32_t flags;
+    cli_and_save(flags);
+    display_terminal->origin = 0;
+    display_terminal->sb_view = 0;
+    set_display_start(DISPLAY_START(display_terminal));
+    memset_word(SCREEN_CELL(display_terminal, 0, 0), (color_scheme[display_terminal->tid] << 8) | ' ', SCREEN_CELLS);
     display_terminal->screen_x= 0;
     display_terminal->screen_y = 0;
     enable_cursor(0, NUM_ROWS);         // enable the cursor, and set its range.
     switch_cursor(display_terminal->screen_x, display_terminal->screen_y);  // put the cursor at the top-left corner.
-    if (running_terminal != display_terminal){
-        terminal_backup(running_terminal->tid);
+    restore_flags(flags);
+}
+
+/* void fmt_putc(fmt_out_t* out, int8_t c);
+ * Inputs: out = the output of the formatter
+ *           c = character to append
+ * Return Value: void
+ * Function: Append a character to the buffer of the formatter. A full buffer
+ *           is written to the screen if the output is printf, otherwise the
+ *           rest of the text is dropped but still counted */
+static void fmt_putc(fmt_out_t* out, int8_t c) {
+    if (out->len + 1 >= out->size) {
+        if (out->flush == 0) {
+            out->total++;
+            return;
+        }
+        putbuf(out->buf, out->len);
+        out->len = 0;
     }
+    out->buf[out->len++] = c;
+    out->total++;
 }
 
-/* Standard printf().
- * Only supports the following format strings:
- * %%  - print a literal '%' character
- * %x  - print a number in hexadecimal
- * %u  - print a number as an unsigned integer
- * %d  - print a number as a signed integer
- * %c  - print a character
- * %s  - print a string
- * %#x - print a number in 32-bit aligned hexadecimal, i.e.
- *       print 8 hexadecimal digits, zero-padded on the left.
- *       For example, the hex number "E" would be printed as
- *       "0000000E".
- *       Note: This is slightly different than the libc specification
- *       for the "#" modifier (this implementation doesn't add a "0x" at
- *       the beginning), but I think it's more flexible this way.
- *       Also note: %x is the only conversion specifier that can use
- *       the "#" modifier to alter output. */
-int32_t printf(int8_t *format, ...) {
+/* void fmt_puts(fmt_out_t* out, int8_t* s);
+ * Inputs: out = the output of the formatter
+ *           s = string to append
+ * Return Value: void
+ * Function: Append a string to the buffer of the formatter */
+static void fmt_puts(fmt_out_t* out, int8_t* s) {
+    while (*s != '\0') {
+        fmt_putc(out, *s);
+        s++;
+    }
+}
+
+/* int32_t do_format(fmt_out_t* out, int8_t* format, int32_t* esp);
+ * Inputs:    out = the output of the formatter
+ *         format = the format string, see printf
+ *            esp = the first parameter after the format string
+ * Return Value: the length of the whole text, even if it was cut
+ * Function: The formatter shared by printf and snprintf. The text is
+ *           always NULL-terminated in the buffer of out */
+static int32_t do_format(fmt_out_t* out, int8_t* format, int32_t* esp) {
 
     /* Pointer to the format string */
     int8_t* buf = format;
 
-    /* Stack pointer for the other parameters */
-    int32_t* esp = (void *)&format;
-    esp++;
-
     while (*buf != '\0') {
         switch (*buf) {
             case '%':
@@ -79,7 +114,7 @@ format_char_switch:
                     switch (*buf) {
                         /* Print a literal '%' character */
                         case '%':
-                            putc('%');
+                            fmt_putc(out, '%');
                             break;
 
                         /* Use alternate formatting */
@@ -97,7 +132,7 @@ format_char_switch:
                                 int8_t conv_buf[64];
                                 if (alternate == 0) {
                                     itoa(*((uint32_t *)esp), conv_buf, 16);
-                                    puts(conv_buf);
+                                    fmt_puts(out, conv_buf);
                                 } else {
                                     int32_t starting_index;
                                     int32_t i;
@@ -107,7 +142,7 @@ format_char_switch:
                                         conv_buf[i] = '0';
                                         i++;
                                     }
-                                    puts(&conv_buf[starting_index]);
+                                    fmt_puts(out, &conv_buf[starting_index]);
                                 }
                                 esp++;
                             }
@@ -118,7 +153,7 @@ format_char_switch:
                             {
                                 int8_t conv_buf[36];
                                 itoa(*((uint32_t *)esp), conv_buf, 10);
-                                puts(conv_buf);
+                                fmt_puts(out, conv_buf);
                                 esp++;
                             }
                             break;
@@ -134,20 +169,20 @@ format_char_switch:
                                 } else {
                                     itoa(value, conv_buf, 10);
                                 }
-                                puts(conv_buf);
+                                fmt_puts(out, conv_buf);
                                 esp++;
                             }
                             break;
 
                         /* Print a single character */
                         case 'c':
-                            putc((uint8_t) *((int32_t *)esp));
+                            fmt_putc(out, (uint8_t) *((int32_t *)esp));
                             esp++;
                             break;
 
                         /* Print a NULL-terminated string */
                         case 's':
-                            puts(*((int8_t **)esp));
+                            fmt_puts(out, *((int8_t **)esp));
                             esp++;
                             break;
 
@@ -159,12 +194,75 @@ format_char_switch:
                 break;
 
             default:
-                putc(*buf);
+                fmt_putc(out, *buf);
                 break;
         }
         buf++;
     }
-    return (buf - format);
+    if (out->size > 0) out->buf[out->len] = '\0';
+    return out->total;
+}
+
+/* Standard printf().
+ * Only supports the following format strings:
+ * %%  - print a literal '%' character
+ * %x  - print a number in hexadecimal
+ * %u  - print a number as an unsigned integer
+ * %d  - print a number as a signed integer
+ * %c  - print a character
+ * %s  - print a string
+ * %#x - print a number in 32-bit aligned hexadecimal, i.e.
+ *       print 8 hexadecimal digits, zero-padded on the left.
+ *       For example, the hex number "E" would be printed as
+ *       "0000000E".
+ *       Note: This is slightly different than the libc specification
+ *       for the "#" modifier (this implementation doesn't add a "0x" at
+ *       the beginning), but I think it's more flexible this way.
+ *       Also note: %x is the only conversion specifier that can use
+ *       the "#" modifier to alter output.
+ * The text is formatted into a buffer on the stack and written to the
+ * screen with putbuf, so a call takes the lock and moves the cursor once
+ * unless the text is longer than PRINTF_BUF. */
+int32_t printf(int8_t *format_str, ...) {
+    int8_t buf[PRINTF_BUF];
+    fmt_out_t out = {buf, PRINTF_BUF, 0, 0, 1};
+
+    /* Stack pointer for the other parameters */
+    int32_t* esp = (void *)&format_str;
+    esp++;
+
+    int32_t len = do_format(&out, format_str, esp);
+    putbuf(buf, out.len);
+    return len;
+}
+
+/* int32_t snprintf(int8_t* buf, int32_t size, int8_t* format, ...);
+ * Inputs:    buf = destination buffer
+ *           size = size of the buffer, including the NULL
+ *         format = the format string, see printf
+ * Return Value: the length of the whole text, the text was cut if this is not less than size
+ * Function: Format a string like printf, but into buf instead of the screen */
+int32_t snprintf(int8_t* buf, int32_t size, int8_t* format_str, ...) {
+    fmt_out_t out = {buf, size, 0, 0, 0};
+    int32_t* esp = (void *)&format_str;
+    esp++;
+
+    if (size < 0) out.size = 0;
+    return do_format(&out, format_str, esp);
+}
+
+/* int32_t vsnprintf(int8_t* buf, int32_t size, int8_t* format, int32_t* args);
+ * Inputs:    buf = destination buffer
+ *           size = size of the buffer, including the NULL
+ *         format = the format string, see printf
+ *           args = the first parameter after the format string on the stack
+ * Return Value: the length of the whole text, the text was cut if this is not less than size
+ * Function: snprintf for functions which take a format and their own parameters */
+int32_t vsnprintf(int8_t* buf, int32_t size, int8_t* format_str, int32_t* args) {
+    fmt_out_t out = {buf, size, 0, 0, 0};
+
+    if (size < 0) out.size = 0;
+    return do_format(&out, format_str, args);
 }
 
 /* int32_t puts(int8_t* s);
@@ -172,12 +270,9 @@ format_char_switch:
  *   Return Value: Number of bytes written
  *    Function: Output a string to the console */
 int32_t puts(int8_t* s) {
-    register int32_t index = 0;
-    while (s[index] != '\0') {
-        putc(s[index]);
-        index++;
-    }
-    return index;
+    int32_t len = strlen(s);
+    putbuf(s, len);
+    return len;
 }
 
 /* void putc(uint8_t c);
@@ -185,32 +280,193 @@ int32_t puts(int8_t* s) {
  * Return Value: void
  * Function: Output a character to the console */
 void putc(uint8_t c) {
-    cli();
-    int32_t flag_scroll = 0;   // a flag indicates whether to scroll the screen
+    putbuf((int8_t*)&c, 1);
+}
 
-    if(c == '\n' || c == '\r') { // start a new line
-        running_terminal->screen_y++;
-        running_terminal->screen_x = 0;
-        if (running_terminal->screen_y == NUM_ROWS){  // if the cursor is going to exceed the screen, roll the screen up
-            flag_scroll = 1;
+/* int32_t run_length(const int8_t* s, int32_t n);
+ * Inputs: s = characters to print
+ *         n = number of characters
+ * Return Value: the number of characters before the first '\n', '\r' or '\0'
+ * Function: find the run of characters which go straight to the screen */
+static int32_t run_length(const int8_t* s, int32_t n) {
+    int32_t i;      // loop index
+    for (i = 0; i < n; ++i) {
+        if (s[i] == '\n' || s[i] == '\r' || s[i] == '\0') break;
+    }
+    return i;
+}
+
+/* int32_t putbuf(const int8_t* s, int32_t n);
+ * Inputs: s = characters to print
+ *         n = number of characters
+ * Return Value: n
+ * Function: Output n characters to the screen of the running terminal,
+ *           see putbufv */
+int32_t putbuf(const int8_t* s, int32_t n) {
+    iovec_t iov;
+    iov.iov_base = (void*)s;
+    iov.iov_len = n;
+    return putbufv(&iov, 1);
+}
+
+/* int32_t putbufv(const iovec_t* iov, int32_t cnt);
+ * Inputs: iov = the buffers to print, in order
+ *         cnt = number of buffers
+ * Return Value: the total number of characters
+ * Function: Output the buffers to the screen of the running terminal as
+ *           one text. It is rendered in two passes over its runs of
+ *           printable characters. The first one only counts the lines, so
+ *           the screen is scrolled once by all of them, the second one
+ *           writes the cells of the lines which are still on the screen
+ *           afterwards. Interrupts are off for the whole text and the
+ *           cursor is moved once at the end, so nothing else gets printed
+ *           in between two buffers. '\0' is skipped. The text is copied to
+ *           the serial console as well */
+int32_t putbufv(const iovec_t* iov, int32_t cnt) {
+    uint32_t flags;
+    int32_t i, j, v;    // loop index
+    int32_t n;          // length of the current buffer
+    int32_t len;        // length of the current run
+    int32_t total = 0;
+    const int8_t* s;
+    uint16_t cell = (uint16_t)color_scheme[current_color] << 8;
+
+    cli_and_save(flags);
+    int32_t x = running_terminal->screen_x;
+    int32_t y = running_terminal->screen_y;
+
+    // count the lines, y may go past the screen here
+    for (v = 0; v < cnt; ++v) {
+        s = (const int8_t*)iov[v].iov_base;
+        n = iov[v].iov_len;
+        if (s == NULL || n <= 0) continue;
+        serial_write(s, n);
+        total += n;
+        for (i = 0; i < n; ++i) {
+            len = run_length(s + i, n - i);
+            y += (x + len) / NUM_COLS;
+            x = (x + len) % NUM_COLS;
+            i += len;
+            if (i < n && s[i] != '\0') {
+                x = 0;
+                y++;
+            }
         }
-    } else {
-        *(uint8_t *)(video_mem + ((NUM_COLS * running_terminal->screen_y + running_terminal->screen_x) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS * running_terminal->screen_y + running_terminal->screen_x) << 1) + 1) = color_scheme[current_color];
-        running_terminal->screen_x++;
-        running_terminal->screen_y = (running_terminal->screen_y + (running_terminal->screen_x / NUM_COLS));
-        running_terminal->screen_x %= NUM_COLS;
-        if (running_terminal->screen_y == NUM_ROWS){  // if the cursor is going to exceed the screen, roll the screen up
-            flag_scroll = 1;
+    }
+
+    // the rows above shift are gone, scroll everything else at once.
+    // All of them go to the scrollback first and the loop below fills them
+    int32_t shift = y - (NUM_ROWS - 1);
+    if (shift > 0) scroll_up(running_terminal, cell >> 8, shift);
+    else shift = 0;
+
+    x = running_terminal->screen_x;
+    y = running_terminal->screen_y;
+    for (v = 0; v < cnt; ++v) {
+        s = (const int8_t*)iov[v].iov_base;
+        n = iov[v].iov_len;
+        if (s == NULL || n <= 0) continue;
+        for (i = 0; i < n; ++i) {
+            len = run_length(s + i, n - i);
+            for (j = 0; j < len; ) {
+                int32_t chunk = NUM_COLS - x;       // the rest of the row
+                if (chunk > len - j) chunk = len - j;
+                // rows above shift have scrolled off, they only go to the scrollback
+                uint16_t* dest = (y >= shift) ? SCREEN_CELL(running_terminal, 0, y - shift)
+                                              : scrollback_line(running_terminal, shift - y);
+                if (dest != NULL) {
+                    const uint8_t* src = (const uint8_t*)s + i + j;
+                    int32_t k;
+                    dest += x;
+                    for (k = 0; k < chunk; ++k) dest[k] = cell | src[k];
+                }
+                j += chunk;
+                x += chunk;
+                if (x == NUM_COLS) {
+                    x = 0;
+                    y++;
+                }
+            }
+            i += len;
+            if (i < n && s[i] != '\0') {       // '\n' or '\r' starts a new line
+                x = 0;
+                y++;
+            }
         }
     }
-    if (flag_scroll == 1){
-        roll_up();
-        sti();
-        return;
+
+    running_terminal->screen_x = x;
+    running_terminal->screen_y = y - shift;
+    update_cursor(x, y - shift);
+    restore_flags(flags);
+    return total;
+}
+
+/* int32_t screen_pans(terminal_t* t);
+ * Inputs: t = the terminal
+ * Return Value: 1 if the screen of t scrolls by moving its origin, 0 if it is copied
+ * Function: a screen does not pan while its program has vidmap, since the
+ *           program draws at the start of the video memory of the terminal */
+static int32_t screen_pans(terminal_t* t) {
+    return t->pid == -1 || get_PCB(t->pid)->flag_vidmem == 0;
+}
+
+/* void scroll_up(terminal_t* t, uint8_t attr, int32_t lines);
+ * Inputs: t = the terminal
+ *      attr = attribute of the new empty lines
+ *     lines = number of lines to scroll, more than NUM_ROWS pushes
+ *             empty lines to the scrollback after the whole screen
+ * Return Value: void
+ * Function: move the screen up by lines, without touching the cursor.
+ *           The lines leaving the top are appended to the scrollback.
+ *           The screen keeps its old lines in the RING_CELLS cells of the
+ *           terminal and only moves its origin down, which is the CRTC
+ *           start address if the terminal is shown. It is copied back to
+ *           the top once it reaches the end of them */
+static void scroll_up(terminal_t* t, uint8_t attr, int32_t lines) {
+    uint32_t i;      // loop index
+    uint16_t* line;
+    uint16_t* base = (uint16_t*)t->video_mem_buf;
+    for (i = 0; i < lines; ++i) {
+        if ((line = scrollback_push(t)) == NULL) break;
+        if (lines - i > SCROLLBACK_LINES) continue;     // overwritten by the later lines anyway
+        if (i < NUM_ROWS) memcpy(line, SCREEN_CELL(t, 0, i), NUM_COLS * 2);
+        else memset_word(line, (attr << 8) | ' ', NUM_COLS);
     }
-    update_cursor(running_terminal->screen_x, running_terminal->screen_y);
-    sti();
+
+    if (lines > NUM_ROWS) lines = NUM_ROWS;
+    if (screen_pans(t)) {
+        if (t->origin + (NUM_ROWS + lines) * NUM_COLS <= RING_CELLS) {
+            t->origin += lines * NUM_COLS;
+        } else {
+            memmove(base, SCREEN_CELL(t, 0, lines), (NUM_ROWS - lines) * NUM_COLS * 2);
+            t->origin = 0;
+        }
+        if (t == display_terminal && t->sb_view == 0) set_display_start(DISPLAY_START(t));
+    } else {
+        memmove(base, base + lines * NUM_COLS, (NUM_ROWS - lines) * NUM_COLS * 2);
+    }
+    memset_word(SCREEN_CELL(t, 0, NUM_ROWS - lines), (attr << 8) | ' ', lines * NUM_COLS);
+}
+
+/* void screen_home(int32_t tid);
+ * Inputs: tid = the terminal
+ * Return Value: void
+ * Function: copy the screen of the terminal back to the start of its
+ *           video memory and stop panning, vidmap needs the screen there */
+void screen_home(int32_t tid) {
+    uint32_t flags;
+    terminal_t* t = &terminal_array[tid];
+    cli_and_save(flags);
+    if (t->origin != 0) {
+        memmove((void*)t->video_mem_buf, SCREEN_CELL(t, 0, 0), SCREEN_CELLS * 2);
+        t->origin = 0;
+        if (t == display_terminal && t->sb_view == 0) {
+            set_display_start(DISPLAY_START(t));
+            switch_cursor(t->screen_x, t->screen_y);
+        }
+    }
+    restore_flags(flags);
 }
 
 /* void putc_visible(uint8_t c);
@@ -219,8 +475,7 @@ void putc(uint8_t c) {
  * Function: Output a character to the console */
 void putc_visible(uint8_t c) {
     cli();
-    terminal_video();
-
+    serial_write((int8_t*)&c, 1);
     int32_t flag_scroll = 0;   // a flag indicates whether to scroll the screen
 
     if(c == '\n' || c == '\r') { // start a new line
@@ -230,8 +485,7 @@ void putc_visible(uint8_t c) {
             flag_scroll = 1;
         }
     } else {
-        *(uint8_t *)(video_mem + ((NUM_COLS * display_terminal->screen_y + display_terminal->screen_x) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS * display_terminal->screen_y + display_terminal->screen_x) << 1) + 1) = color_scheme[display_terminal->tid];
+        *SCREEN_CELL(display_terminal, display_terminal->screen_x, display_terminal->screen_y) = (color_scheme[display_terminal->tid] << 8) | c;
         display_terminal->screen_x++;
         display_terminal->screen_y = (display_terminal->screen_y + (display_terminal->screen_x / NUM_COLS));
         display_terminal->screen_x %= NUM_COLS;
@@ -246,9 +500,6 @@ void putc_visible(uint8_t c) {
     }
     switch_cursor(display_terminal->screen_x, display_terminal->screen_y);
 
-    if (running_terminal != display_terminal){
-        terminal_backup(running_terminal->tid);
-    }
     sti();
 }
 
@@ -258,14 +509,16 @@ void putc_visible(uint8_t c) {
  * Function: delete a character
  */
 void deletec(uint32_t first_row){
-    terminal_video();
-
+    uint32_t flags;
+    cli_and_save(flags);
     if (first_row == 1){    // the current cursor is at the first row of the input lines
-        if (display_terminal->screen_x == 0) return;  // if there is no character to delete, do nothing
+        if (display_terminal->screen_x == 0){  // if there is no character to delete, do nothing
+            restore_flags(flags);
+            return;
+        }
         // delete one character, and update the cursor
         --display_terminal->screen_x;
-        *(uint8_t *)(video_mem + ((NUM_COLS * display_terminal->screen_y + display_terminal->screen_x) << 1)) = ' ';
-        *(uint8_t *)(video_mem + ((NUM_COLS * display_terminal->screen_y + display_terminal->screen_x) << 1) + 1) = color_scheme[display_terminal->tid];
+        *SCREEN_CELL(display_terminal, display_terminal->screen_x, display_terminal->screen_y) = (color_scheme[display_terminal->tid] << 8) | ' ';
     }
     else{                   // the current cursor is not at the first row of the input lines
         if (display_terminal->screen_x == 0){         // if this row is empty, delete the last character in the previous row
@@ -275,14 +528,10 @@ void deletec(uint32_t first_row){
         else{
             --display_terminal->screen_x;
         }
-        *(uint8_t *)(video_mem + ((NUM_COLS * display_terminal->screen_y + display_terminal->screen_x) << 1)) = ' ';
-        *(uint8_t *)(video_mem + ((NUM_COLS * display_terminal->screen_y + display_terminal->screen_x) << 1) + 1) = color_scheme[display_terminal->tid];
+        *SCREEN_CELL(display_terminal, display_terminal->screen_x, display_terminal->screen_y) = (color_scheme[display_terminal->tid] << 8) | ' ';
     }
     switch_cursor(display_terminal->screen_x, display_terminal->screen_y);
-
-    if (running_terminal != display_terminal){
-        terminal_backup(running_terminal->tid);
-    }
+    restore_flags(flags);
 }
 
 /* void roll_up ();
@@ -291,15 +540,7 @@ void deletec(uint32_t first_row){
  * Function: roll the screen up one line
  */
 void roll_up (){
-    uint32_t i;      // loop index
-    for (i = 0; i < (NUM_ROWS - 1) * NUM_COLS; ++i){
-        *(uint8_t *)(video_mem + (i << 1)) = *(uint8_t *)(video_mem + ((i + NUM_COLS) << 1));
-        *(uint8_t *)(video_mem + (i << 1) + 1) = *(uint8_t *)(video_mem + ((i + NUM_COLS) << 1) + 1);
-    }
-    for (i = (NUM_ROWS - 1) * NUM_COLS; i < NUM_ROWS * NUM_COLS; ++i){
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = color_scheme[current_color];
-    }
+    scroll_up(running_terminal, color_scheme[current_color], 1);
     running_terminal->screen_y = NUM_ROWS - 1;
     running_terminal->screen_x = 0;
     update_cursor(running_terminal->screen_x, running_terminal->screen_y);
@@ -311,23 +552,11 @@ void roll_up (){
  * Function: roll the screen up one line
  */
 void roll_up_visible (){
-    terminal_video();
-    uint32_t i;      // loop index
-    for (i = 0; i < (NUM_ROWS - 1) * NUM_COLS; ++i){
-        *(uint8_t *)(video_mem + (i << 1)) = *(uint8_t *)(video_mem + ((i + NUM_COLS) << 1));
-        *(uint8_t *)(video_mem + (i << 1) + 1) = *(uint8_t *)(video_mem + ((i + NUM_COLS) << 1) + 1);
-    }
-    for (i = (NUM_ROWS - 1) * NUM_COLS; i < NUM_ROWS * NUM_COLS; ++i){
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = color_scheme[display_terminal->tid];
-    }
+    scroll_up(display_terminal, color_scheme[display_terminal->tid], 1);
     display_terminal->screen_y = NUM_ROWS - 1;
     display_terminal->screen_x = 0;
     switch_cursor(display_terminal->screen_x, display_terminal->screen_y);
 
-    if (running_terminal != display_terminal){
-        terminal_backup(running_terminal->tid);
-    }
 }
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
@@ -390,33 +619,99 @@ int8_t* strrev(int8_t* s) {
 /* uint32_t strlen(const int8_t* s);
  * Inputs: const int8_t* s = string to take length of
  * Return Value: length of string s
- * Function: return length of string s */
+ * Function: return length of string s, a word at a time once s is aligned.
+ *           An aligned load never crosses into the next page, so reading
+ *           past the terminator inside the last word is safe */
 uint32_t strlen(const int8_t* s) {
-    register uint32_t len = 0;
-    while (s[len] != '\0')
-        len++;
-    return len;
+    const int8_t* p = s;
+    while ((uint32_t)p & 0x3) {
+        if (*p == '\0')
+            return p - s;
+        p++;
+    }
+    while (!HAS_ZERO_BYTE(*(const uint32_t*)p))
+        p += 4;
+    while (*p != '\0')
+        p++;
+    return p - s;
 }
 
-/* void* memset(void* s, int32_t c, uint32_t n);
+/* void init_mem_ops();
+ * Inputs: none
+ * Return Value: none
+ * Function: pick the memcpy and memset variants through CPUID. ERMSB is
+ *           CPUID leaf 7 EBX bit 9, SSE2 and FXSR are leaf 1 EDX bits 26
+ *           and 24. SSE instructions fault until CR4.OSFXSR is set, so
+ *           that is done here too */
+void init_mem_ops() {
+    uint32_t max_leaf, ebx, edx;
+    asm volatile ("cpuid" : "=a"(max_leaf) : "a"(0) : "ebx", "ecx", "edx");
+    asm volatile ("cpuid" : "=d"(edx) : "a"(1) : "ebx", "ecx");
+    if (max_leaf >= 7) {
+        asm volatile ("cpuid" : "=b"(ebx) : "a"(7), "c"(0) : "edx");
+        if (ebx & CPUID_ERMS) mem_features |= MEM_ERMS;
+    }
+    if ((edx & CPUID_SSE2) && (edx & CPUID_FXSR)) {
+        asm volatile ("                 \n\
+                movl    %%cr0, %%eax    \n\
+                andl    $~0x4, %%eax    \n\
+                orl     $0x2, %%eax     \n\
+                movl    %%eax, %%cr0    \n\
+                movl    %%cr4, %%eax    \n\
+                orl     $0x600, %%eax   \n\
+                movl    %%eax, %%cr4    \n\
+                "
+                :
+                :
+                : "eax"
+        );
+        mem_features |= MEM_SSE2;
+    }
+}
+
+/* uint32_t sse_begin();
+ * Inputs: none
+ * Return Value: the flags to give to sse_end
+ * Function: the kernel does not save the SSE registers on a switch, so
+ *           they are saved here with interrupts off, which also keeps the
+ *           single save area from being used twice at once */
+static uint32_t sse_begin() {
+    uint32_t flags;
+    cli_and_save(flags);
+    asm volatile ("fxsave %0" : "=m"(sse_save));
+    return flags;
+}
+
+/* void sse_end(uint32_t flags);
+ * Inputs: the flags from sse_begin
+ * Return Value: none
+ * Function: restore the SSE registers and the interrupt flag */
+static void sse_end(uint32_t flags) {
+    asm volatile ("fxrstor %0" : : "m"(sse_save));
+    restore_flags(flags);
+}
+
+/* void* memset_rep_stosl(void* s, int32_t c, uint32_t n);
  * Inputs:    void* s = pointer to memory
  *          int32_t c = value to set memory to
  *         uint32_t n = number of bytes to set
  * Return Value: new string
- * Function: set n consecutive bytes of pointer s to value c */
-void* memset(void* s, int32_t c, uint32_t n) {
+ * Function: set n consecutive bytes of pointer s to value c, bytes up to a
+ *           dword boundary, then rep stosl, then the last bytes */
+void* memset_rep_stosl(void* s, int32_t c, uint32_t n) {
+    void* ret = s;
     c &= 0xFF;
     asm volatile ("                 \n\
-            .memset_top:            \n\
+            1:                      \n\
             testl   %%ecx, %%ecx    \n\
-            jz      .memset_done    \n\
+            jz      4f              \n\
             testl   $0x3, %%edi     \n\
-            jz      .memset_aligned \n\
+            jz      2f              \n\
             movb    %%al, (%%edi)   \n\
             addl    $1, %%edi       \n\
             subl    $1, %%ecx       \n\
-            jmp     .memset_top     \n\
-            .memset_aligned:        \n\
+            jmp     1b              \n\
+            2:                      \n\
             movw    %%ds, %%dx      \n\
             movw    %%dx, %%es      \n\
             movl    %%ecx, %%edx    \n\
@@ -424,22 +719,103 @@ void* memset(void* s, int32_t c, uint32_t n) {
             andl    $0x3, %%edx     \n\
             cld                     \n\
             rep     stosl           \n\
-            .memset_bottom:         \n\
+            3:                      \n\
             testl   %%edx, %%edx    \n\
-            jz      .memset_done    \n\
+            jz      4f              \n\
             movb    %%al, (%%edi)   \n\
             addl    $1, %%edi       \n\
             subl    $1, %%edx       \n\
-            jmp     .memset_bottom  \n\
-            .memset_done:           \n\
+            jmp     3b              \n\
+            4:                      \n\
             "
-            :
-            : "a"(c << 24 | c << 16 | c << 8 | c), "D"(s), "c"(n)
+            : "+D"(s), "+c"(n)
+            : "a"(c << 24 | c << 16 | c << 8 | c)
+            : "edx", "memory", "cc"
+    );
+    return ret;
+}
+
+/* void* memset_rep_stosb(void* s, int32_t c, uint32_t n);
+ * Inputs:    same as memset
+ * Return Value: new string
+ * Function: set n bytes with a single rep stosb, which is the fastest way on
+ *           CPUs with enhanced rep movsb/stosb (ERMSB) */
+void* memset_rep_stosb(void* s, int32_t c, uint32_t n) {
+    void* ret = s;
+    asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     stosb           \n\
+            "
+            : "+D"(s), "+c"(n)
+            : "a"(c)
             : "edx", "memory", "cc"
     );
+    return ret;
+}
+
+/* void* memset_sse2_nt(void* s, int32_t c, uint32_t n);
+ * Inputs:    same as memset
+ * Return Value: new string
+ * Function: set n bytes with 16 byte non-temporal stores, which bypass the
+ *           cache, so a big memset does not evict everything else.
+ *           The SSE state is saved around every MEM_NT_CHUNK bytes, see
+ *           sse_begin, so interrupts are not held off for the whole set */
+void* memset_sse2_nt(void* s, int32_t c, uint32_t n) {
+    uint32_t flags;
+    uint8_t* dest = (uint8_t*)s;
+    uint32_t head = (16 - ((uint32_t)dest & 0xF)) & 0xF;
+    if (head > n) head = n;
+    memset_rep_stosl(dest, c, head);
+    dest += head;
+    n -= head;
+
+    uint32_t blocks = n / 64;
+    c &= 0xFF;
+    uint32_t pattern = c << 24 | c << 16 | c << 8 | c;
+    while (blocks != 0) {
+        uint32_t chunk = (blocks < MEM_NT_CHUNK / 64) ? blocks : MEM_NT_CHUNK / 64;
+        blocks -= chunk;
+        flags = sse_begin();
+        asm volatile ("                     \n\
+                movd    %2, %%xmm0          \n\
+                pshufd  $0, %%xmm0, %%xmm0  \n\
+                1:                          \n\
+                movntdq %%xmm0, (%0)        \n\
+                movntdq %%xmm0, 16(%0)      \n\
+                movntdq %%xmm0, 32(%0)      \n\
+                movntdq %%xmm0, 48(%0)      \n\
+                addl    $64, %0             \n\
+                subl    $1, %1              \n\
+                jnz     1b                  \n\
+                sfence                      \n\
+                "
+                : "+r"(dest), "+r"(chunk)
+                : "r"(pattern)
+                : "memory", "cc"
+        );
+        sse_end(flags);
+    }
+    memset_rep_stosl(dest, c, n & 63);
     return s;
 }
 
+/* void* memset(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: new string
+ * Function: set n consecutive bytes of pointer s to value c, with the fastest
+ *           variant found by init_mem_ops */
+void* memset(void* s, int32_t c, uint32_t n) {
+    if (n >= MEM_NT_MIN && (mem_features & MEM_SSE2))
+        return memset_sse2_nt(s, c, n);
+    if (mem_features & MEM_ERMS)
+        return memset_rep_stosb(s, c, n);
+    return memset_rep_stosl(s, c, n);
+}
+
 /* void* memset_word(void* s, int32_t c, uint32_t n);
  * Description: Optimized memset_word
  * Inputs:    void* s = pointer to memory
@@ -481,26 +857,28 @@ void* memset_dword(void* s, int32_t c, uint32_t n) {
     return s;
 }
 
-/* void* memcpy(void* dest, const void* src, uint32_t n);
+/* void* memcpy_rep_movsl(void* dest, const void* src, uint32_t n);
  * Inputs:      void* dest = destination of copy
  *         const void* src = source of copy
  *              uint32_t n = number of byets to copy
  * Return Value: pointer to dest
- * Function: copy n bytes of src to dest */
-void* memcpy(void* dest, const void* src, uint32_t n) {
+ * Function: copy n bytes of src to dest, bytes up to a dword boundary of
+ *           dest, then rep movsl, then the last bytes */
+void* memcpy_rep_movsl(void* dest, const void* src, uint32_t n) {
+    void* ret = dest;
     asm volatile ("                 \n\
-            .memcpy_top:            \n\
+            1:                      \n\
             testl   %%ecx, %%ecx    \n\
-            jz      .memcpy_done    \n\
+            jz      4f              \n\
             testl   $0x3, %%edi     \n\
-            jz      .memcpy_aligned \n\
+            jz      2f              \n\
             movb    (%%esi), %%al   \n\
             movb    %%al, (%%edi)   \n\
             addl    $1, %%edi       \n\
             addl    $1, %%esi       \n\
             subl    $1, %%ecx       \n\
-            jmp     .memcpy_top     \n\
-            .memcpy_aligned:        \n\
+            jmp     1b              \n\
+            2:                      \n\
             movw    %%ds, %%dx      \n\
             movw    %%dx, %%es      \n\
             movl    %%ecx, %%edx    \n\
@@ -508,49 +886,137 @@ void* memcpy(void* dest, const void* src, uint32_t n) {
             andl    $0x3, %%edx     \n\
             cld                     \n\
             rep     movsl           \n\
-            .memcpy_bottom:         \n\
+            3:                      \n\
             testl   %%edx, %%edx    \n\
-            jz      .memcpy_done    \n\
+            jz      4f              \n\
             movb    (%%esi), %%al   \n\
             movb    %%al, (%%edi)   \n\
             addl    $1, %%edi       \n\
             addl    $1, %%esi       \n\
             subl    $1, %%edx       \n\
-            jmp     .memcpy_bottom  \n\
-            .memcpy_done:           \n\
+            jmp     3b              \n\
+            4:                      \n\
             "
+            : "+S"(src), "+D"(dest), "+c"(n)
             :
-            : "S"(src), "D"(dest), "c"(n)
             : "eax", "edx", "memory", "cc"
     );
+    return ret;
+}
+
+/* void* memcpy_rep_movsb(void* dest, const void* src, uint32_t n);
+ * Inputs:      same as memcpy
+ * Return Value: pointer to dest
+ * Function: copy n bytes with a single rep movsb, which the CPU runs in
+ *           cache line sized pieces when it has ERMSB */
+void* memcpy_rep_movsb(void* dest, const void* src, uint32_t n) {
+    void* ret = dest;
+    asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     movsb           \n\
+            "
+            : "+S"(src), "+D"(dest), "+c"(n)
+            :
+            : "edx", "memory", "cc"
+    );
+    return ret;
+}
+
+/* void* memcpy_sse2_nt(void* dest, const void* src, uint32_t n);
+ * Inputs:      same as memcpy
+ * Return Value: pointer to dest
+ * Function: copy 64 bytes per round with unaligned 16 byte loads and
+ *           non-temporal stores to the 16 byte aligned dest, so a big copy
+ *           does not evict everything else from the cache. The SSE state
+ *           is saved around every MEM_NT_CHUNK bytes, see sse_begin, so
+ *           interrupts are not held off for the whole copy */
+void* memcpy_sse2_nt(void* dest, const void* src, uint32_t n) {
+    uint32_t flags;
+    uint8_t* to = (uint8_t*)dest;
+    const uint8_t* from = (const uint8_t*)src;
+    uint32_t head = (16 - ((uint32_t)to & 0xF)) & 0xF;
+    if (head > n) head = n;
+    memcpy_rep_movsl(to, from, head);
+    to += head;
+    from += head;
+    n -= head;
+
+    uint32_t blocks = n / 64;
+    while (blocks != 0) {
+        uint32_t chunk = (blocks < MEM_NT_CHUNK / 64) ? blocks : MEM_NT_CHUNK / 64;
+        blocks -= chunk;
+        flags = sse_begin();
+        asm volatile ("                     \n\
+                1:                          \n\
+                movdqu  (%1), %%xmm0        \n\
+                movdqu  16(%1), %%xmm1      \n\
+                movdqu  32(%1), %%xmm2      \n\
+                movdqu  48(%1), %%xmm3      \n\
+                movntdq %%xmm0, (%0)        \n\
+                movntdq %%xmm1, 16(%0)      \n\
+                movntdq %%xmm2, 32(%0)      \n\
+                movntdq %%xmm3, 48(%0)      \n\
+                addl    $64, %1             \n\
+                addl    $64, %0             \n\
+                subl    $1, %2              \n\
+                jnz     1b                  \n\
+                sfence                      \n\
+                "
+                : "+r"(to), "+r"(from), "+r"(chunk)
+                :
+                : "memory", "cc"
+        );
+        sse_end(flags);
+    }
+    memcpy_rep_movsl(to, from, n & 63);
     return dest;
 }
 
+/* void* memcpy(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: copy n bytes of src to dest, with the fastest variant found by
+ *           init_mem_ops. Before that only rep movsl is used */
+void* memcpy(void* dest, const void* src, uint32_t n) {
+    if (n >= MEM_NT_MIN && (mem_features & MEM_SSE2))
+        return memcpy_sse2_nt(dest, src, n);
+    if (mem_features & MEM_ERMS)
+        return memcpy_rep_movsb(dest, src, n);
+    return memcpy_rep_movsl(dest, src, n);
+}
+
 /* void* memmove(void* dest, const void* src, uint32_t n);
  * Description: Optimized memmove (used for overlapping memory areas)
  * Inputs:      void* dest = destination of move
  *         const void* src = source of move
  *              uint32_t n = number of byets to move
  * Return Value: pointer to dest
- * Function: move n bytes of src to dest */
+ * Function: move n bytes of src to dest. Unless dest overlaps the end of
+ *           src, a forward copy is safe and memcpy is used, otherwise the
+ *           bytes are moved backwards */
 void* memmove(void* dest, const void* src, uint32_t n) {
+    if ((uint32_t)dest <= (uint32_t)src || (uint32_t)dest - (uint32_t)src >= n)
+        return memcpy(dest, src, n);
+
+    void* ret = dest;
     asm volatile ("                             \n\
             movw    %%ds, %%dx                  \n\
             movw    %%dx, %%es                  \n\
-            cld                                 \n\
-            cmp     %%edi, %%esi                \n\
-            jae     .memmove_go                 \n\
             leal    -1(%%esi, %%ecx), %%esi     \n\
             leal    -1(%%edi, %%ecx), %%edi     \n\
             std                                 \n\
-            .memmove_go:                        \n\
             rep     movsb                       \n\
+            cld                                 \n\
             "
+            : "+D"(dest), "+S"(src), "+c"(n)
             :
-            : "D"(dest), "S"(src), "c"(n)
             : "edx", "memory", "cc"
     );
-    return dest;
+    return ret;
 }
 
 /* int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n)
@@ -566,6 +1032,27 @@ void* memmove(void* dest, const void* src, uint32_t n) {
  * Function: compares string 1 and string 2 for equality */
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
     int32_t i;
+
+    /* if both strings have the same alignment, skip equal words without a
+     * terminator, the byte loop below finds the exact difference */
+    if ((((uint32_t)s1 ^ (uint32_t)s2) & 0x3) == 0) {
+        while (((uint32_t)s1 & 0x3) && n != 0) {
+            if ((*s1 != *s2) || (*s1 == '\0'))
+                return *s1 - *s2;
+            s1++;
+            s2++;
+            n--;
+        }
+        while (n >= 4) {
+            uint32_t w = *(const uint32_t*)s1;
+            if (w != *(const uint32_t*)s2 || HAS_ZERO_BYTE(w))
+                break;
+            s1 += 4;
+            s2 += 4;
+            n -= 4;
+        }
+    }
+
     for (i = 0; i < n; i++) {
         if ((s1[i] != s2[i]) || (s1[i] == '\0') /* || s2[i] == '\0' */) {
 
@@ -584,9 +1071,21 @@ int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
  * Inputs:      int8_t* dest = destination string of copy
  *         const int8_t* src = source string of copy
  * Return Value: pointer to dest
- * Function: copy the source string into the destination string */
+ * Function: copy the source string into the destination string. Once src
+ *           is aligned, whole words without the terminator are copied at
+ *           once, x86 does not mind the unaligned stores to dest */
 int8_t* strcpy(int8_t* dest, const int8_t* src) {
     int32_t i = 0;
+    while (((uint32_t)(src + i) & 0x3) && src[i] != '\0') {
+        dest[i] = src[i];
+        i++;
+    }
+    if (src[i] != '\0') {
+        while (!HAS_ZERO_BYTE(*(const uint32_t*)(src + i))) {
+            *(uint32_t*)(dest + i) = *(const uint32_t*)(src + i);
+            i += 4;
+        }
+    }
     while (src[i] != '\0') {
         dest[i] = src[i];
         i++;
@@ -600,9 +1099,20 @@ int8_t* strcpy(int8_t* dest, const int8_t* src) {
  *         const int8_t* src = source string of copy
  *                uint32_t n = number of bytes to copy
  * Return Value: pointer to dest
- * Function: copy n bytes of the source string into the destination string */
+ * Function: copy n bytes of the source string into the destination string,
+ *           a word at a time like strcpy, the rest of dest is cleared */
 int8_t* strncpy(int8_t* dest, const int8_t* src, uint32_t n) {
     int32_t i = 0;
+    while (((uint32_t)(src + i) & 0x3) && src[i] != '\0' && i < n) {
+        dest[i] = src[i];
+        i++;
+    }
+    if (i < n && src[i] != '\0') {
+        while (n - i >= 4 && !HAS_ZERO_BYTE(*(const uint32_t*)(src + i))) {
+            *(uint32_t*)(dest + i) = *(const uint32_t*)(src + i);
+            i += 4;
+        }
+    }
     while (src[i] != '\0' && i < n) {
         dest[i] = src[i];
         i++;
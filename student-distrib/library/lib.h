@@ -8,6 +8,8 @@
 #define VIDEO       0xB8000
 #define NUM_COLS    80
 #define NUM_ROWS    25
+#define SCREEN_CELLS (NUM_COLS * NUM_ROWS)
+#define RING_CELLS  0x1000          // each terminal scrolls through its own 8 kB of video memory
 #define ATTRIB      0x7
 #define TER_0       0xCF
 #define TER_1       0xB0
@@ -20,6 +22,10 @@ int32_t current_color;
 
 void init_colorScheme();
 int32_t printf(int8_t *format, ...);
+int32_t snprintf(int8_t* buf, int32_t size, int8_t* format, ...);
+int32_t vsnprintf(int8_t* buf, int32_t size, int8_t* format, int32_t* args);
+int32_t putbuf(const int8_t* s, int32_t n);
+int32_t putbufv(const iovec_t* iov, int32_t cnt);
 void putc(uint8_t c);
 void putc_visible(uint8_t c);
 void deletec(uint32_t first_row);
@@ -32,19 +38,39 @@ void test_interrupts(void);
 
 void roll_up ();
 void roll_up_visible();
+void screen_home(int32_t tid);
 
+/* CPU features used by memcpy and memset, found by init_mem_ops */
+#define CPUID_ERMS  (1 << 9)        // leaf 7 EBX
+#define CPUID_FXSR  (1 << 24)       // leaf 1 EDX
+#define CPUID_SSE2  (1 << 26)       // leaf 1 EDX
+#define MEM_ERMS    0x1             // rep movsb/stosb is fast
+#define MEM_SSE2    0x2             // SSE2 is enabled
+#define MEM_NT_MIN  0x40000         // from this size on, copies bypass the cache
+#define MEM_NT_CHUNK 0x8000         // bytes copied per sse_begin, interrupts are off meanwhile
+
+extern uint32_t mem_features;
+
+void init_mem_ops();
 void* memset(void* s, int32_t c, uint32_t n);
+void* memset_rep_stosl(void* s, int32_t c, uint32_t n);
+void* memset_rep_stosb(void* s, int32_t c, uint32_t n);
+void* memset_sse2_nt(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
 void* memset_dword(void* s, int32_t c, uint32_t n);
 void* memcpy(void* dest, const void* src, uint32_t n);
+void* memcpy_rep_movsl(void* dest, const void* src, uint32_t n);
+void* memcpy_rep_movsb(void* dest, const void* src, uint32_t n);
+void* memcpy_sse2_nt(void* dest, const void* src, uint32_t n);
 void* memmove(void* dest, const void* src, uint32_t n);
+/* nonzero if any byte of the 32 bit word w is 0 */
+#define HAS_ZERO_BYTE(w)    (((w) - 0x01010101) & ~(w) & 0x80808080)
+
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
 int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
 
-/* Userspace address-check functions */
-int32_t bad_userspace_addr(const void* addr, int32_t len);
-int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
+/* Userspace address-check functions are in uaccess.h */
 
 /* Port read functions */
 /* Inb reads a byte and returns its value as a zero-extended 32-bit
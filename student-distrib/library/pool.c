@@ -0,0 +1,131 @@
+/*
+*   Fixed-size object pools. The owner hands over the memory, e.g. a static
+*   array, and the pool keeps the free objects on a stack. Nothing is ever
+*   taken from the heap, so the objects have stable addresses and getting one
+*   can not fail for any reason but the pool being empty.
+*/
+
+#include "pool.h"
+#include "lib.h"
+#include "../procfs.h"
+
+static pool_t* pool_list[POOL_MAX];     // the pools shown in the proc file "pools"
+static int32_t pool_num = 0;
+
+
+
+/*
+ * void pool_init (pool_t* pool, const int8_t* name, void* storage, uint32_t obj_size, int32_t capacity)
+ * inputs:          the pool, its name, capacity objects of obj_size bytes at storage
+ * return value:    none
+ * outputs:         push every object on the free stack, the first object ends on top
+ * notes:           obj_size should keep the objects aligned
+ */
+void pool_init(pool_t* pool, const int8_t* name, void* storage, uint32_t obj_size, int32_t capacity){
+    int32_t i;  // loop index
+    pool->name = name;
+    pool->base = (uint8_t*)storage;
+    pool->obj_size = (obj_size < sizeof(void*)) ? sizeof(void*) : obj_size;
+    pool->capacity = capacity;
+    pool->free_top = NULL;
+    for (i = capacity - 1; i >= 0; --i){
+        void* obj = pool->base + i * pool->obj_size;
+        *(void**)obj = pool->free_top;
+        pool->free_top = obj;
+    }
+    pool->in_use = 0;
+    pool->peak = 0;
+    pool->gets = 0;
+    pool->fails = 0;
+
+    if (pool_num == 0) procfs_register("pools", pool_show);
+    if (pool_num < POOL_MAX) pool_list[pool_num++] = pool;
+}
+
+
+
+/*
+ * void* pool_get (pool_t* pool)
+ * inputs:          the pool
+ * return value:    a free object, NULL if all of them are in use
+ * outputs:         pop the free stack
+ * notes:           O(1), the content of the object is undefined
+ */
+void* pool_get(pool_t* pool){
+    uint32_t flags;
+    cli_and_save(flags);
+    void* obj = pool->free_top;
+    if (obj == NULL){
+        pool->fails++;
+        restore_flags(flags);
+        return NULL;
+    }
+    pool->free_top = *(void**)obj;
+    pool->gets++;
+    if (++pool->in_use > pool->peak) pool->peak = pool->in_use;
+    restore_flags(flags);
+    return obj;
+}
+
+
+
+/*
+ * int32_t pool_put (pool_t* pool, void* obj)
+ * inputs:          the pool and one of its objects
+ * return value:    0 on success, -1 if obj does not belong to the pool
+ * outputs:         push the object on the free stack
+ * notes:           O(1), an object put twice is not detected
+ */
+int32_t pool_put(pool_t* pool, void* obj){
+    uint32_t flags;
+    if (pool_index(pool, obj) == -1) return -1;
+    cli_and_save(flags);
+    *(void**)obj = pool->free_top;
+    pool->free_top = obj;
+    pool->in_use--;
+    restore_flags(flags);
+    return 0;
+}
+
+
+
+/*
+ * int32_t pool_index (pool_t* pool, const void* obj)
+ * inputs:          the pool and an object
+ * return value:    the position of the object in the pool, -1 if it is not one of its objects
+ * outputs:         none
+ * notes:           
+ */
+int32_t pool_index(pool_t* pool, const void* obj){
+    uint32_t offset = (uint32_t)obj - (uint32_t)pool->base;
+    if ((uint32_t)obj < (uint32_t)pool->base || offset % pool->obj_size != 0) return -1;
+    if (offset / pool->obj_size >= (uint32_t)pool->capacity) return -1;
+    return offset / pool->obj_size;
+}
+
+
+
+/*
+ * int32_t pool_show (uint8_t* buf, int32_t size)
+ * inputs:          the text buffer and its size
+ * return value:    the length of the text
+ * outputs:         the text of the proc file "pools": one line of statistics per pool
+ * notes:           
+ */
+int32_t pool_show(uint8_t* buf, int32_t size){
+    int32_t i;  // loop index
+    int32_t len = 0;
+    len = proc_puts(buf, len, size, (int8_t*)"name            size  total in use   peak       gets  fails\n");
+    for (i = 0; i < pool_num; ++i){
+        len = proc_puts(buf, len, size, pool_list[i]->name);
+        len = proc_puts(buf, len, size, (int8_t*)"            " + strlen(pool_list[i]->name));
+        len = proc_putu(buf, len, size, pool_list[i]->obj_size, 8);
+        len = proc_putu(buf, len, size, pool_list[i]->capacity, 7);
+        len = proc_putu(buf, len, size, pool_list[i]->in_use, 7);
+        len = proc_putu(buf, len, size, pool_list[i]->peak, 7);
+        len = proc_putu(buf, len, size, pool_list[i]->gets, 11);
+        len = proc_putu(buf, len, size, pool_list[i]->fails, 7);
+        len = proc_puts(buf, len, size, (int8_t*)"\n");
+    }
+    return len;
+}
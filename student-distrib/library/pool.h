@@ -0,0 +1,39 @@
+/*
+*   Pools of fixed-size objects in memory given by the owner of the pool
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "../types.h"
+
+#define POOL_MAX        8           // pools listed in the proc file "pools"
+
+/*
+ * the free objects form a stack linked through their first word, so get and
+ * put are O(1) and an object never moves while it is in use
+ */
+typedef struct pool{
+    const int8_t* name;
+    uint8_t* base;              // the first object
+    uint32_t obj_size;          // at least the size of a pointer
+    int32_t capacity;           // the number of objects
+    void* free_top;             // the most recently freed object, NULL if all are in use
+
+    // statistics
+    int32_t in_use;
+    int32_t peak;               // the most objects in use at once
+    uint32_t gets;
+    uint32_t fails;             // pool_get calls with no free object
+}pool_t;
+
+/* typed access, e.g. POOL_GET(&line_pool, uint8_t) */
+#define POOL_GET(pool, type)    ((type*)pool_get(pool))
+
+void pool_init(pool_t* pool, const int8_t* name, void* storage, uint32_t obj_size, int32_t capacity);
+void* pool_get(pool_t* pool);
+int32_t pool_put(pool_t* pool, void* obj);
+int32_t pool_index(pool_t* pool, const void* obj);
+int32_t pool_show(uint8_t* buf, int32_t size);
+
+#endif
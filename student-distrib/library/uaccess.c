@@ -0,0 +1,108 @@
+/*
+*   Every pointer a user program hands to a system call is checked here
+*   against the mappings of the running process before the kernel touches it.
+*   A range is checked once per call, the copy itself is a plain memcpy.
+*/
+
+#include "uaccess.h"
+#include "lib.h"
+#include "../paging.h"
+#include "../process.h"
+
+#define VIDMAP_SIZE     0x1000      // vidmap maps a single 4kB page
+
+extern int32_t running_process;     // records the current running process, -1 indicates no running process
+
+
+
+/*
+ * int32_t in_range (uint32_t addr, uint32_t len, uint32_t start, uint32_t end)
+ * inputs:          the range [addr, addr + len) and the mapping [start, end)
+ * return value:    1 if the whole range lies inside the mapping, 0 otherwise
+ * outputs:         none
+ * notes:           written so that addr + len can not overflow
+ */
+static int32_t in_range(uint32_t addr, uint32_t len, uint32_t start, uint32_t end){
+    if (addr < start || addr >= end) return 0;
+    return len <= end - addr;
+}
+
+
+
+/*
+ * int32_t bad_userspace_addr (const void* addr, int32_t len)
+ * inputs:          addr is the start of a user buffer and len is its length in bytes
+ * return value:    0 if the whole buffer is mapped for the running process, 1 otherwise
+ * outputs:         none
+ * notes:           the user program page is always mapped, the video page only after vidmap
+ *                  and the frame buffer only after vidmap_fb
+ */
+int32_t bad_userspace_addr(const void* addr, int32_t len){
+    if (addr == NULL || len < 0) return 1;
+    if (running_process == -1) return 1;    // no user program, no user memory
+
+    if (in_range((uint32_t)addr, (uint32_t)len, VIR_USER_PRO, VIR_USER_END)) return 0;
+    if (get_PCB(running_process)->flag_vidmem &&
+        in_range((uint32_t)addr, (uint32_t)len, SCREEN_START, SCREEN_START + VIDMAP_SIZE)) return 0;
+    if (get_PCB(running_process)->flag_fb &&
+        in_range((uint32_t)addr, (uint32_t)len, FB_START, FB_START + FB_PAGES * SIZE_4KB)) return 0;
+    return 1;
+}
+
+
+
+/*
+ * int32_t copy_from_user (void* to, const void* from, int32_t n)
+ * inputs:          to is a kernel buffer, from is a user buffer, n is the number of bytes
+ * return value:    0 on success, -1 if the user buffer is not mapped
+ * outputs:         copy n bytes from user memory into the kernel
+ * notes:
+ */
+int32_t copy_from_user(void* to, const void* from, int32_t n){
+    if (to == NULL || bad_userspace_addr(from, n)) return -1;
+    memcpy(to, from, n);
+    return 0;
+}
+
+
+
+/*
+ * int32_t copy_to_user (void* to, const void* from, int32_t n)
+ * inputs:          to is a user buffer, from is a kernel buffer, n is the number of bytes
+ * return value:    0 on success, -1 if the user buffer is not mapped
+ * outputs:         copy n bytes from the kernel into user memory
+ * notes:
+ */
+int32_t copy_to_user(void* to, const void* from, int32_t n){
+    if (from == NULL || bad_userspace_addr(to, n)) return -1;
+    memcpy(to, from, n);
+    return 0;
+}
+
+
+
+/*
+ * int32_t safe_strncpy (int8_t* dest, const int8_t* src, int32_t n)
+ * inputs:          dest is a kernel buffer of n bytes, src is a user string
+ * return value:    the length of the string, -1 if src is not mapped or the
+ *                  string does not fit into n bytes with its '\0'
+ * outputs:         copy the user string into dest, always '\0' terminated on success
+ * notes:           the string may end anywhere in the mapping, so it is only
+ *                  read up to the end of the mapped range
+ */
+int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n){
+    if (dest == NULL || n <= 0 || bad_userspace_addr(src, 1)) return -1;
+
+    // the number of bytes that can be read before leaving the mapping
+    uint32_t limit = VIR_USER_END - (uint32_t)src;
+    if ((uint32_t)src >= FB_START) limit = FB_START + FB_PAGES * SIZE_4KB - (uint32_t)src;
+    else if ((uint32_t)src >= SCREEN_START) limit = SCREEN_START + VIDMAP_SIZE - (uint32_t)src;
+    if (limit > (uint32_t)n) limit = n;
+
+    uint32_t i;     // loop index
+    for (i = 0; i < limit; ++i){
+        dest[i] = src[i];
+        if (src[i] == '\0') return i;
+    }
+    return -1;      // no terminator found
+}
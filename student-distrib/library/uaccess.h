@@ -0,0 +1,15 @@
+/*
+*   This file deals with all the accesses to user memory made by system calls
+*/
+
+#ifndef UACCESS_H
+#define UACCESS_H
+
+#include "../types.h"
+
+int32_t bad_userspace_addr(const void* addr, int32_t len);
+int32_t copy_from_user(void* to, const void* from, int32_t n);
+int32_t copy_to_user(void* to, const void* from, int32_t n);
+int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
+
+#endif
@@ -4,6 +4,7 @@
 #include "process.h"
 #include "terminal.h"
 #include "library/dynamic_allocation.h"
+#include "buddy.h"
 
 
 
@@ -35,14 +36,23 @@ void init_paging(){
         page_dir[0].pde_4K.S = 0;
         page_dir[0].pde_4K.Address = (uint32_t) page_tbl >> 12; // only the highest 20 bits are needed
 
-        // initialize the page table, particularly, initialize the video memory pte, and the other 3 backup memory
-        for (i = 0; i < 4; ++i){
+        // initialize the page table, particularly, the video memory of all the terminals
+        for (i = 0; i < VIDEO_MEM_PAGES; ++i){
             int32_t address = VIDEO_MEM_ADDR + i * SIZE_4KB;
             page_tbl[address >> 12].P = 1;
             page_tbl[address >> 12].R = 1;
             page_tbl[address >> 12].U = 0;
             page_tbl[address >> 12].Address = address >> 12;    // only the highest 20 bits are needed
         }
+
+        // the graphics window, only the kernel writes to it
+        for (i = 0; i < FB_PAGES; ++i){
+            int32_t address = FB_MEM_ADDR + i * SIZE_4KB;
+            page_tbl[address >> 12].P = 1;
+            page_tbl[address >> 12].R = 1;
+            page_tbl[address >> 12].U = 0;
+            page_tbl[address >> 12].Address = address >> 12;    // only the highest 20 bits are needed
+        }
         
 
         // initialize the second 4MB, which is the kernel memory
@@ -56,6 +66,12 @@ void init_paging(){
         page_dir[1].pde_4M.S = 1;
         page_dir[1].pde_4M.Address = KERNEL_MEM_ADDR >> 22; // only the highest 10 bits are needed
 
+        // the last entry maps the directory itself, which makes every page table visible at PAGE_TABLES
+        page_dir[PDE_SIZE - 1].pde_4K.P = 1;
+        page_dir[PDE_SIZE - 1].pde_4K.R = 1;
+        page_dir[PDE_SIZE - 1].pde_4K.U = 0;
+        page_dir[PDE_SIZE - 1].pde_4K.Address = (uint32_t) page_dir >> 12; // only the highest 20 bits are needed
+
         // enable the paging, refer to OSDev
         asm volatile(
 			"movl %0, %%eax;"
@@ -95,8 +111,8 @@ int32_t process_paging (int32_t pid){
     page_dir[VIR_USER_PRO >> shift_offset].pde_4M.A = 0;
     page_dir[VIR_USER_PRO >> shift_offset].pde_4M.reserved_0 = 0;
     page_dir[VIR_USER_PRO >> shift_offset].pde_4M.S = 1;
-    // the first user program is loaded at physical 8 MB, and the second at 12 MB, etc.
-    page_dir[VIR_USER_PRO >> shift_offset].pde_4M.Address = (PHY_USER_START >> shift_offset) + pid;
+    // every process has its own 4 MB frame from the buddy allocator
+    page_dir[VIR_USER_PRO >> shift_offset].pde_4M.Address = get_PCB(pid)->user_frame >> shift_offset;
 
     // flush the TLB
     // reference: OSDEV
@@ -157,7 +173,7 @@ void vidmem_paging (int32_t address){
  * notes:           user page table is defined in paging.h
  */
 void vidmem_disable(){
-    page_dir[SCREEN_START / SIZE_4MB].pde_4K.P = 0;
+    page_dir[SCREEN_START / SIZE_4MB].pde_4K.P = page_tbl_user[FB_PTE].P;   // the frame buffer may still need the table
     page_tbl_user[0].P = 0;
 
     // flush the TLB
@@ -174,80 +190,105 @@ void vidmem_disable(){
 
 
 /*
- * void terminal_backup ()
- * inputs:          int32_t tid
- * return value:    none 
- * outputs:         remaps the virtual video memory to one of the backup memories
- * notes:           page table is defined in paging.h
+ * void invlpg (uint32_t vaddr)
+ * inputs:          a virtual address
+ * return value:    none
+ * outputs:         drop the TLB entry of the page holding vaddr
+ * notes:
  */
-void terminal_backup (int32_t tid){
-    // virtual video memory maps to the backup physical memory
-    int32_t address = VIDEO_MEM_ADDR + (tid + 1) * SIZE_4KB;
-    page_tbl[VIDEO_MEM_ADDR >> 12].P = 1;
-    page_tbl[VIDEO_MEM_ADDR >> 12].R = 1;
-    page_tbl[VIDEO_MEM_ADDR >> 12].U = 0;
-    page_tbl[VIDEO_MEM_ADDR >> 12].Address = address >> 12; // only the highest 20 bits are needed
-    
-    // flush the TLB
-    // reference: OSDEV
-    asm volatile (
-		"mov %%cr3, %%eax;"
-		"mov %%eax, %%cr3;"
-		:                      /* no outputs */
-		:                      /* no inputs */
-		:"%eax"                /* clobbered register */
-    );
+static void invlpg(uint32_t vaddr){
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
 }
 
 
 
 /*
- * void terminal_video ()
- * inputs:          none
- * return value:    none 
- * outputs:         remaps the virtual video memory to the physical video memory
- * notes:           page table is defined in paging.h
+ * void fb_paging (uint32_t address)
+ * inputs:          the 4 kB aligned frame buffer of the running process, 0 if it has none
+ * return value:    none
+ * outputs:         map the FB_PAGES pages from address at FB_START, or unmap them
+ * notes:           called at every process switch, so only the entries which change are
+ *                  written and dropped from the TLB
  */
-void terminal_video (){
-    page_tbl[VIDEO_MEM_ADDR >> 12].P = 1;
-    page_tbl[VIDEO_MEM_ADDR >> 12].R = 1;
-    page_tbl[VIDEO_MEM_ADDR >> 12].U = 0;
-    page_tbl[VIDEO_MEM_ADDR >> 12].Address = VIDEO_MEM_ADDR >> 12;  // only the highest 20 bits are needed
-
-    // flush the TLB
-    // reference: OSDEV
-    asm volatile (
-		"mov %%cr3, %%eax;"
-		"mov %%eax, %%cr3;"
-		:                      /* no outputs */
-		:                      /* no inputs */
-		:"%eax"                /* clobbered register */
-    );
+void fb_paging (uint32_t address){
+    int32_t i;      // loop index
+    if (address != 0 && !page_dir[SCREEN_START / SIZE_4MB].pde_4K.P){
+        page_dir[SCREEN_START / SIZE_4MB].pde_4K.val = 0;
+        page_dir[SCREEN_START / SIZE_4MB].pde_4K.P = 1;
+        page_dir[SCREEN_START / SIZE_4MB].pde_4K.R = 1;
+        page_dir[SCREEN_START / SIZE_4MB].pde_4K.U = 1;
+        page_dir[SCREEN_START / SIZE_4MB].pde_4K.Address = (uint32_t) page_tbl_user >> 12;  // only the highest 20 bits are needed
+    }
+    for (i = 0; i < FB_PAGES; ++i){
+        pte_t* pte = &page_tbl_user[FB_PTE + i];
+        if (address == 0){
+            if (!pte->P) continue;
+            pte->val = 0;
+        }
+        else {
+            if (pte->P && pte->Address == (address >> 12) + i) continue;
+            pte->val = 0;
+            pte->P = 1;
+            pte->R = 1;
+            pte->U = 1;
+            pte->Address = (address >> 12) + i;     // only the highest 20 bits are needed
+        }
+        invlpg(FB_START + i * SIZE_4KB);
+    }
 }
 
 
 
 /*
- * void heap_setup() ()
- * inputs:          none
- * return value:    none 
- * outputs:         set up heap paging
+ * int32_t kernel_map_page (uint32_t vaddr)
+ * inputs:          a 4 kB aligned kernel virtual address which is not mapped
+ * return value:    0 on success, -1 if the buddy allocator is out of frames
+ * outputs:         back vaddr with a new frame, the page table is created on demand
+ * notes:           the page tables come from the buddy allocator too, they are reached
+ *                  through the self mapping at PAGE_TABLES since they may be above 8 MB
  */
-void heap_setup(){
-    int32_t index = HEAP_START >> 22;
-    page_dir[index].pde_4M.P = 1;
-    page_dir[index].pde_4M.R = 1;
-    page_dir[index].pde_4M.U = 1;
-    page_dir[index].pde_4M.S = 1;
-    page_dir[index].pde_4M.Address = HEAP_START >> 22; // only the highest 10 bits are needed
+int32_t kernel_map_page(uint32_t vaddr){
+    uint32_t index = vaddr >> 22;
+    pte_t* table = (pte_t*)(PAGE_TABLES + index * SIZE_4KB);
+
+    if (!page_dir[index].pde_4K.P){
+        uint32_t frame = buddy_alloc(0);
+        if (frame == 0) return -1;
+        page_dir[index].pde_4K.val = 0;
+        page_dir[index].pde_4K.P = 1;
+        page_dir[index].pde_4K.R = 1;
+        page_dir[index].pde_4K.Address = frame >> 12;  // only the highest 20 bits are needed
+        invlpg((uint32_t)table);
+        memset(table, 0, SIZE_4KB);
+    }
+
+    uint32_t frame = buddy_alloc(0);
+    if (frame == 0) return -1;
+    pte_t* pte = &table[(vaddr >> 12) & (PTE_SIZE - 1)];
+    pte->val = 0;
+    pte->P = 1;
+    pte->R = 1;
+    pte->Address = frame >> 12;     // only the highest 20 bits are needed
+    invlpg(vaddr);
+    return 0;
+}
 
-    // flush the TLB
-    // reference: OSDEV
-    asm volatile (
-		"mov %%cr3, %%eax;"
-		"mov %%eax, %%cr3;"
-		:                      /* no outputs */
-		:                      /* no inputs */
-		:"%eax"                /* clobbered register */
-    );
+
+
+/*
+ * void kernel_unmap_page (uint32_t vaddr)
+ * inputs:          a virtual address mapped by kernel_map_page
+ * return value:    none
+ * outputs:         unmap the page and give its frame back to the buddy allocator
+ * notes:           the page table stays, the heap will probably grow there again
+ */
+void kernel_unmap_page(uint32_t vaddr){
+    uint32_t index = vaddr >> 22;
+    if (!page_dir[index].pde_4K.P || page_dir[index].pde_4K.S) return;
+
+    pte_t* pte = (pte_t*)(PAGE_TABLES + index * SIZE_4KB) + ((vaddr >> 12) & (PTE_SIZE - 1));
+    if (!pte->P) return;
+    buddy_free(pte->Address << 12);
+    pte->val = 0;
+    invlpg(vaddr);
 }
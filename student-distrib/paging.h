@@ -9,11 +9,18 @@
 #define SIZE_4MB        0x400000
 #define VIDEO_MEM_ADDR  0xB8000
 #define VIDEO_MEM_END   0xB8FFF
+#define VIDEO_MEM_PAGES 8               // the whole 32 kB of text mode memory, 0xB8000 - 0xBFFFF
+#define VIDEO_REGION    0x2000          // every terminal owns 8 kB of text mode memory from 0xB8000 on
+#define VIDEO_VIEW      0xBE000         // the page shown while the display terminal looks at its scrollback
+#define FB_MEM_ADDR     0xA0000         // the graphics window of mode 13h
+#define FB_PAGES        16              // its 64 kB, also the size of the user frame buffer
+#define FB_PTE          16              // the user frame buffer follows the video page in page_tbl_user
 #define KERNEL_MEM_ADDR 0x400000
 #define KERNEL_MEM_END  0x7FFFFF
-#define PHY_USER_START  0x800000
 #define VIR_USER_PRO    0x8000000
 #define VIR_USER_END    0x8400000
+#define PAGE_TABLES     0xFFC00000      // the last directory entry points to the directory itself,
+                                        // so the page table of vaddr is at PAGE_TABLES + (vaddr >> 22) * 4 kB
 
 
 
@@ -107,11 +114,11 @@ pte_t page_tbl_user[PTE_SIZE] __attribute__((aligned (SIZE_4KB)));
 // declarations of paging-related functions
 void init_paging ();
 int32_t process_paging (int32_t pid);
-void terminal_backup (int32_t tid);
-void terminal_video ();
 void vidmem_paging (int32_t address);
 void vidmem_disable();
-void heap_setup();
+void fb_paging (uint32_t address);
+int32_t kernel_map_page(uint32_t vaddr);
+void kernel_unmap_page(uint32_t vaddr);
 
 
 #endif
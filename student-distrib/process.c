@@ -1,5 +1,12 @@
 #include "process.h"
 #include "x86_desc.h"
+#include "kthread.h"
+#include "buddy.h"
+#include "library/dynamic_allocation.h"
+#include "library/pool.h"
+#include "klog.h"
+#include "vga.h"
+#include "ldisc.h"
 
 
 int32_t process_counter = 0;    // counts the number of existing process 
@@ -7,6 +14,7 @@ int32_t running_process = -1;   // records the current running process, -1 indic
 fd_t* fd_array;                 // the file descriptor array of current porcess
 extern tss_t tss;               
 int32_t shells_booted = 0;          // a flag indicating whether all three basic shells have been booted
+static pool_t pcb_pool;             // the kernel stacks, each with its PCB at the bottom
 
 
 
@@ -31,18 +39,30 @@ PCB_t* get_PCB(int32_t pid){
  *  INPUTS:     none
  *  OUTPUTS:    none
  *  RETURN VALUE: return a pid, or -1 on failure
+ *  NOTES:      O(1), the kernel stacks are kept in a pool, the one of pid 0 is the
+ *              highest, so the position in the pool counts down
  */
 int32_t get_new_pid(){
-    if (process_counter >= MAX_PROCESS) return -1;
-    int32_t i;  // loop index
-    for (i = 0; i < MAX_PROCESS; ++i){
-        PCB_t* ptr = get_PCB(i);
-        if (ptr->pid == -1){    // -1 indicates this block is unused
-            ptr->pid = i;
-            return i;
-        }
-    }
-    return -1;  // no valid pid found
+    PCB_t* ptr = (PCB_t*)pool_get(&pcb_pool);
+    if (ptr == NULL) return -1;
+    ptr->pid = MAX_PROCESS - 1 - pool_index(&pcb_pool, ptr);
+    return ptr->pid;
+}
+
+
+
+/* 
+ *  void put_pid (int32_t pid)
+ *  DESCRIPTION: give a pid back
+ *  INPUTS:     a pid from get_new_pid
+ *  OUTPUTS:    mark the PCB unused, i.e., pid = -1, and return its kernel stack to the pool
+ *  RETURN VALUE: none
+ */
+void put_pid(int32_t pid){
+    PCB_t* ptr = get_PCB(pid);
+    if (ptr == NULL || ptr->pid == -1) return;
+    ptr->pid = -1;
+    pool_put(&pcb_pool, ptr);
 }
 
 
@@ -53,13 +73,20 @@ int32_t get_new_pid(){
  *  INPUTS:     none
  *  OUTPUTS:    set all the PCB to unused, i.e., pid = -1
  *  RETURN VALUE: none
+ *  NOTES:      pid 0 is on top of the pool, so the shells get 0, 1 and 2
  */
 void init_PCB(){
     uint32_t i;  // loop index
+    pool_init(&pcb_pool, (int8_t*)"pcb", get_PCB(MAX_PROCESS - 1), KERNEL_STACK_SIZE, MAX_PROCESS);
+    // pool_init leaves the lowest stack on top, turn the stack over
+    for (i = 0; i < MAX_PROCESS; ++i) pool_get(&pcb_pool);
     for (i = 0; i < MAX_PROCESS; ++i){
-        PCB_t* ptr = get_PCB(i);
+        PCB_t* ptr = get_PCB(MAX_PROCESS - 1 - i);
         ptr->pid = -1;
+        pool_put(&pcb_pool, ptr);
     }
+    pcb_pool.gets = 0;
+    pcb_pool.peak = 0;
 }
 
 
@@ -118,23 +145,44 @@ int32_t switch_fd(fd_t* fd_array_in){
 
 
 /* 
- *  int32_t process_create (const uint8_t* command)
- *  DESCRIPTION: create a new process based on the command
- *  INPUTS:     command arguments
- *  OUTPUTS:    parse the arguments, set up paging, load the program and initialize the corresponding PCB 
- *  RETURN VALUE: return 0 on success, -1 on failure 
+ *  uint32_t program_end (uint32_t size)
+ *  DESCRIPTION: find where the loaded program ends, the user heap starts there
+ *  INPUTS:     the size of the executable, already copied to LOADING_ADDR
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the end of the last loadable segment (its bss included), aligned
+ *                to USER_HEAP_ALIGN, or the end of the file if the headers make no sense
  */
-int32_t process_create (const uint8_t* command){
-    cli();
+static uint32_t program_end(uint32_t size){
+    uint8_t* elf = (uint8_t*)LOADING_ADDR;
+    uint32_t end = LOADING_ADDR + size;
+    uint32_t phoff = *(uint32_t*)(elf + 28);        // 28-31 are the offset of the program headers
+    uint16_t phentsize = *(uint16_t*)(elf + 42);    // 42-43 are the size of one header
+    uint16_t phnum = *(uint16_t*)(elf + 44);        // 44-45 are the number of headers
+    int32_t i;  // loop index
 
-    if (!command) return -1;
+    if (phentsize >= 24 && phoff < size && phnum <= (size - phoff) / phentsize){
+        for (i = 0; i < phnum; ++i){
+            uint32_t* phdr = (uint32_t*)(elf + phoff + i * phentsize);
+            if (phdr[0] != 1) continue;             // only PT_LOAD segments take memory
+            uint32_t seg_end = phdr[2] + phdr[5];   // p_vaddr + p_memsz
+            if (seg_end > end && seg_end < VIR_USER_END) end = seg_end;
+        }
+    }
+    return (end + USER_HEAP_ALIGN - 1) & ~(USER_HEAP_ALIGN - 1);
+}
 
-    int32_t rval;
 
-    // parse args
-    uint8_t file_name[MAX_FILENAME_LEN + 1];
-    uint8_t arg[BUFFER_SIZE];
 
+/* 
+ *  int32_t parse_command (const uint8_t* command, uint8_t* file_name, uint8_t* arg)
+ *  DESCRIPTION: split a command into the file name and the argument
+ *  INPUTS:     command -- the command, at most LINE_MAX bytes with its '\0'
+ *              file_name -- gets the file name, MAX_FILENAME_LEN + 1 bytes
+ *              arg -- gets the first word after the file name, LINE_MAX bytes
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 0 on success, -1 if there is no file name or it is too long
+ */
+int32_t parse_command(const uint8_t* command, uint8_t* file_name, uint8_t* arg){
     int file_name_idx = 0;
     int arg_idx = 0;
     int cmd_idx = 0;
@@ -142,15 +190,38 @@ int32_t process_create (const uint8_t* command){
     while (command[cmd_idx] == ' ') cmd_idx++;
     if (command[cmd_idx] == '\0') return -1;        // no file name
     while (command[cmd_idx] != ' ' && command[cmd_idx] != '\0'){
-        if (file_name_idx > MAX_FILENAME_LEN) return -1;
+        if (file_name_idx >= MAX_FILENAME_LEN) return -1;
         file_name[file_name_idx++] = command[cmd_idx++];
     }
     file_name[file_name_idx] = '\0';
     while (command[cmd_idx] == ' ') cmd_idx++;
-    while (command[cmd_idx] != ' ' && command[cmd_idx] != '\0'){
+    while (command[cmd_idx] != ' ' && command[cmd_idx] != '\0' && arg_idx < LINE_MAX - 1){
         arg[arg_idx++] = command[cmd_idx++];
     }
     arg[arg_idx] = '\0';
+    return 0;
+}
+
+
+
+/* 
+ *  int32_t process_create (const uint8_t* command)
+ *  DESCRIPTION: create a new process based on the command
+ *  INPUTS:     command arguments
+ *  OUTPUTS:    parse the arguments, set up paging, load the program and initialize the corresponding PCB 
+ *  RETURN VALUE: return 0 on success, -1 on failure 
+ */
+int32_t process_create (const uint8_t* command){
+    cli();
+
+    if (!command) return -1;
+
+    int32_t rval;
+
+    // parse args
+    uint8_t file_name[MAX_FILENAME_LEN + 1];
+    uint8_t arg[LINE_MAX];
+    if (parse_command(command, file_name, arg) == -1) return -1;
 
     // executable check
     int i;
@@ -187,7 +258,16 @@ int32_t process_create (const uint8_t* command){
     PCB_t* PCB_ptr = get_PCB(pid);
 
     // fill in PCB info
-    if (init_fd(get_PCB(pid)->fd_array) == -1) return -1;
+    if (init_fd(get_PCB(pid)->fd_array) == -1){
+        put_pid(pid);
+        return -1;
+    }
+    PCB_ptr->user_frame = buddy_alloc(BUDDY_MAX_ORDER);
+    if (PCB_ptr->user_frame == 0){  // out of physical memory
+        if (running_process != -1) switch_fd(get_PCB(running_process)->fd_array);     // init_fd switched to the new files
+        put_pid(pid);
+        return -1;
+    }
     if (process_counter < 3){
         PCB_ptr->parent_pid = -1;
     }
@@ -200,9 +280,13 @@ int32_t process_create (const uint8_t* command){
     PCB_ptr->kebp = (KERNEL_MEM_END + 1) - pid * KERNEL_STACK_SIZE - 4;
     strcpy((int8_t*)PCB_ptr->arg, (int8_t*)arg);
     PCB_ptr->flag_vidmem = 0;
+    PCB_ptr->flag_fb = 0;
+    PCB_ptr->tty_mode = TTY_CANON;
     PCB_ptr->flag_exception = 0;
     PCB_ptr->terminal_ptr = running_terminal;
+    int32_t terminal_pid = running_terminal->pid;   // given back if the program can not be loaded
     PCB_ptr->terminal_ptr->pid = pid;
+    syscall_stats_reset(pid);
 
     // set up the paging mapping for new process
     process_paging(pid);
@@ -210,7 +294,19 @@ int32_t process_create (const uint8_t* command){
     // user-level process loader
     uint8_t* load_buf = (uint8_t*)LOADING_ADDR;
     extern inode_t* inode_start;
-    if (read_data(dentry.inode, 0, load_buf, inode_start[dentry.inode].size) == -1) return -1;
+    if (read_data(dentry.inode, 0, load_buf, inode_start[dentry.inode].size) == -1){
+        // the caller keeps running, give it back its files, its page and its terminal
+        running_terminal->pid = terminal_pid;
+        if (running_process != -1){
+            switch_fd(get_PCB(running_process)->fd_array);
+            process_paging(running_process);
+        }
+        buddy_free(PCB_ptr->user_frame);
+        put_pid(pid);
+        return -1;
+    }
+    PCB_ptr->brk_start = program_end(inode_start[dentry.inode].size);
+    PCB_ptr->brk = PCB_ptr->brk_start;
 
     // update TSS
     tss.ss0 = KERNEL_DS;
@@ -268,17 +364,24 @@ int32_t process_terminate(uint8_t status){
     // get the current PCB
     PCB_t* PCB_ptr = get_PCB(running_process);
     if (PCB_ptr == NULL) {
-        printf("No process is running.\n");
+        klog(KLOG_ERR, "halt: no process is running");
         return -1;
     }
 
+    // give the frame buffer back, this also returns to the text mode
+    if (PCB_ptr->flag_fb == 1) fb_release();
+    // keys for a raw program are not for the shell
+    if (PCB_ptr->tty_mode == TTY_RAW) ldisc_flush(PCB_ptr->terminal_ptr);
+
     // get the parent pid
     int32_t parent = PCB_ptr->parent_pid;
     if (parent == -1){  // check if this is the first process
         printf("\n*********Shell Rebooted*******\n\n");
+        heap_leak_report(running_process);
         running_process = -1;
         process_counter--;
-        PCB_ptr->pid = -1;
+        put_pid(PCB_ptr->pid);
+        buddy_free(PCB_ptr->user_frame);
         process_create((uint8_t*)"shell");
         return -1;
     }
@@ -303,7 +406,9 @@ int32_t process_terminate(uint8_t status){
         running_terminal->pid = parent;
 
         // mark this PCB unused and update the running process
-        PCB_ptr->pid = -1;
+        heap_leak_report(running_process);
+        put_pid(PCB_ptr->pid);
+        buddy_free(PCB_ptr->user_frame);
         running_process = parent;
         process_counter--;
 
@@ -356,12 +461,6 @@ int32_t schedule (){
         current_color++;
         running_terminal = &terminal_array[running_process + 1];
 
-        if (process_counter == 0){
-            terminal_video();
-        }
-        else{
-            terminal_backup(process_counter);
-        }
         if (process_counter == 2) { // all basic shells will have been set up by the end of this function
             shells_booted = 1;
         }
@@ -373,15 +472,70 @@ int32_t schedule (){
     }
 
     // all three basic shells have been booted
+    if (running_kthread != NULL){
+        // leaving a kernel thread, the interrupted process has its context in its PCB already
+        kthread_t* cur_kthread = running_kthread;
+        asm volatile("movl %%esp, %0":"=r" (cur_kthread->kesp));
+        asm volatile("movl %%ebp, %0":"=r" (cur_kthread->kebp));
+        running_kthread = NULL;
+
+        if (cur_kthread->yielded == 1){
+            // the thread is done, resume the process it interrupted without a full switch
+            // yielded stays set until the thread is picked again, see kthread_pick()
+            PCB_t* resume_PCB = get_PCB(running_process);
+            asm volatile(
+                "movl %0, %%esp;"
+                "movl %1, %%ebp;"
+                :
+                : "r" (resume_PCB->kesp), "r" (resume_PCB->kebp)
+                : "memory"
+            );
+            sti();
+            return 0;
+        }
+        // the thread used up the time slice, kthread_pick() resumes it before the
+        // next process, continue with the normal rotation below
+    }
+    else{
+        // save the current kernel context
+        PCB_t* cur_PCB = get_PCB(running_process);
+        asm volatile("movl %%esp, %0":"=r" (cur_PCB->kesp));
+        asm volatile("movl %%ebp, %0":"=r" (cur_PCB->kebp));
+
+        // give deferred work a chance before the next process
+        kthread_t* next_kthread = kthread_pick();
+        if (next_kthread != NULL){
+            running_kthread = next_kthread;
+            next_kthread->yielded = 0;
+            if (next_kthread->state == KTHREAD_NEW){
+                // first run, start the thread on its own stack, kthread_start never returns
+                next_kthread->state = KTHREAD_READY;
+                asm volatile(
+                    "movl %0, %%esp;"
+                    "xorl %%ebp, %%ebp;"
+                    "sti;"
+                    "call kthread_start;"
+                    :
+                    : "r" (next_kthread->stack_top)
+                    : "memory"
+                );
+            }
+            asm volatile(
+                "movl %0, %%esp;"
+                "movl %1, %%ebp;"
+                :
+                : "r" (next_kthread->kesp), "r" (next_kthread->kebp)
+                : "memory"
+            );
+            sti();
+            return 0;
+        }
+    }
+
     int32_t cur_tid = running_terminal->tid;
     int32_t new_tid = cur_tid + 1;
     if (new_tid == 3)   new_tid = 0;    // only 3 terminals allowed
 
-    // save the current kernel context
-    PCB_t* cur_PCB = get_PCB(running_process);
-    asm volatile("movl %%esp, %0":"=r" (cur_PCB->kesp));
-    asm volatile("movl %%ebp, %0":"=r" (cur_PCB->kebp));
-
     // set up context for switching process
     int32_t next_pid = terminal_array[new_tid].pid;
     running_process = next_pid;
@@ -394,18 +548,10 @@ int32_t schedule (){
 
     // set up the paging mapping for new process
     process_paging(next_pid);
-    if (running_terminal == display_terminal){
-        terminal_video();
-        if (next_PCB->flag_vidmem == 1){
-            vidmem_paging(VIDEO_MEM_ADDR);
-        }
-    }
-    else{
-        terminal_backup(new_tid);
-        if (next_PCB->flag_vidmem == 1){
-            vidmem_paging(running_terminal->video_mem_buf);
-        }
+    if (next_PCB->flag_vidmem == 1){
+        vidmem_paging(running_terminal->video_mem_buf);    // every terminal has its own video memory, shown or not
     }
+    fb_map(next_PCB->flag_fb);
 
     // update TSS
     tss.ss0 = KERNEL_DS;
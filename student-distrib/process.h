@@ -8,17 +8,23 @@
 #include "library/lib.h"
 #include "interrupt/sys_call.h"
 #include "terminal.h"
+#include "interrupt/syscall_stats.h"
+#include "ldisc.h"
 
 
 
 #define MAX_FILES           8
+#define MAX_IOV             16
 #define MAX_PROCESS         6
 #define MAGIC_NUM_SIZE      4
 #define ADDR_SIZE           4
 #define LOADING_ADDR        0x8048000
 #define KERNEL_STACK_SIZE   0x2000
 #define USER_STACK          (0x8400000 - 4)
+#define USER_STACK_RESERVE  0x40000     // the heap never grows into the top 256 kB of the user page
+#define USER_HEAP_ALIGN     16
 #define SCREEN_START        0x9000000
+#define FB_START            (SCREEN_START + FB_PTE * SIZE_4KB)     // where vidmap_fb maps the frame buffer
 
 
 
@@ -29,6 +35,9 @@ typedef struct {
     int32_t (*read)(int32_t, void*, int32_t);
     int32_t (*write)(int32_t, const void*, int32_t);
     int32_t (*close)(int32_t);
+    // optional vectored versions, if NULL read/write is called once per buffer
+    int32_t (*readv)(int32_t, const iovec_t*, int32_t);
+    int32_t (*writev)(int32_t, const iovec_t*, int32_t);
 } file_operations_391_t;
 
 
@@ -50,10 +59,15 @@ typedef struct PCB{
     uint32_t kebp;          // kernel base pointer
     uint32_t esp;           // user stack pointer
     uint32_t ebp;           // user base pointer
-    uint8_t arg[BUFFER_SIZE];
+    uint8_t arg[LINE_MAX];
     int32_t flag_vidmem;
+    int32_t flag_fb;        // 1 if the process owns the graphics frame buffer
+    int32_t tty_mode;       // TTY_CANON or TTY_RAW, how read takes the keys of its terminal
     volatile int32_t flag_exception;
     terminal_t* terminal_ptr;
+    uint32_t user_frame;    // physical address of the 4 MB user page
+    uint32_t brk_start;     // the user heap is [brk_start, brk), right behind the program
+    uint32_t brk;
 } PCB_t;
 
 
@@ -62,6 +76,7 @@ typedef struct PCB{
 
 void init_PCB ();
 PCB_t* get_PCB(int32_t pid);
+int32_t parse_command(const uint8_t* command, uint8_t* file_name, uint8_t* arg);
 int32_t process_create (const uint8_t* command);
 int32_t process_terminate(uint8_t status);
 int32_t init_fd(fd_t* fd_array_in);
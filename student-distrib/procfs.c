@@ -0,0 +1,163 @@
+#include "procfs.h"
+#include "filesys.h"
+#include "library/lib.h"
+
+extern fd_t* fd_array;
+
+/*
+ * Proc files are virtual files that open() finds when no file of that name
+ * exists on the disk. Their text is generated again on every read, so a
+ * program always sees the current state of the kernel.
+ */
+static proc_entry_t proc_table[PROCFS_MAX];
+static int32_t proc_num = 0;
+static uint8_t proc_buf[PROCFS_BUF_SIZE];       // the text of the file being read
+
+
+
+/* procfs_register
+ *
+ * Add a proc file.
+ * Inputs:  the name of the file and the function generating its text
+ * Outputs: 0 on success and -1 on failure.
+ * Side Effects: None
+ */
+int32_t procfs_register(const int8_t* name, int32_t (*show)(uint8_t*, int32_t)) {
+    if (name == NULL || show == NULL || proc_num == PROCFS_MAX) return -1;
+    if (strlen(name) == 0 || strlen(name) > MAX_FILENAME_LEN) return -1;
+    proc_table[proc_num].name = name;
+    proc_table[proc_num].show = show;
+    proc_num++;
+    return 0;
+}
+
+
+
+/* procfs_lookup
+ *
+ * Find a proc file by name.
+ * Inputs:  the file name and the dentry to fill
+ * Outputs: 0 on success and -1 if there is no such proc file.
+ * Side Effects: the dentry gets type PROC_FILE, its inode is the index of the proc file
+ */
+int32_t procfs_lookup(const uint8_t* fname, dentry_t* dentry) {
+    if (fname == NULL || dentry == NULL) return -1;
+    int32_t i;
+    for (i = 0; i < proc_num; i++) {
+        if (strlen((int8_t*)fname) != strlen(proc_table[i].name)) continue;
+        if (strncmp((int8_t*)fname, proc_table[i].name, strlen(proc_table[i].name))) continue;
+        strncpy(dentry->name, proc_table[i].name, MAX_FILENAME_LEN);
+        dentry->type = PROC_FILE;
+        dentry->inode = i;
+        return 0;
+    }
+    return -1;
+}
+
+
+
+/* proc_open
+ *
+ * Open a proc file.
+ * Inputs:  file name
+ * Outputs: 0 on success.
+ * Side Effects: None
+ */
+int32_t proc_open(const uint8_t* filename) {
+    return 0;
+}
+
+
+
+/* proc_read
+ *
+ * Read the text of a proc file, starting at the file position.
+ * Inputs: file descriptor number, the destination buffer and the number of bytes to read
+ * Outputs: the number of bytes read, 0 at the end of the file
+ * Side Effects: the text is generated again on every call
+ */
+int32_t proc_read(int32_t fd, void* buf, int32_t nbytes) {
+    uint32_t idx = fd_array[fd].inode;
+    if (idx >= (uint32_t)proc_num) return -1;
+
+    int32_t len = proc_table[idx].show(proc_buf, PROCFS_BUF_SIZE);
+    if (fd_array[fd].file_position >= (uint32_t)len) return 0;
+    len -= fd_array[fd].file_position;
+    if (len > nbytes) len = nbytes;
+    memcpy(buf, proc_buf + fd_array[fd].file_position, len);
+    fd_array[fd].file_position += len;
+    return len;
+}
+
+
+
+/* proc_write
+ *
+ * Read only.
+ * Inputs: file descriptor number, the source buffer and the number of bytes to write
+ * Outputs: return -1 by default
+ * Side Effects: None
+ */
+int32_t proc_write(int32_t fd, const void* buf, int32_t nbytes) {
+    return -1;
+}
+
+
+
+/* proc_close
+ *
+ * Close a proc file.
+ * Inputs: file descriptor number
+ * Outputs: 0 on success
+ * Side Effects: None
+ */
+int32_t proc_close(int32_t fd) {
+    return 0;
+}
+
+
+
+/* proc_puts
+ *
+ * Append a string to the text of a proc file.
+ * Inputs: the buffer, the current length, the size of the buffer and the string
+ * Outputs: the new length, the string is cut if the buffer is full
+ * Side Effects: None
+ */
+int32_t proc_puts(uint8_t* buf, int32_t len, int32_t size, const int8_t* s) {
+    while (*s != '\0' && len < size) buf[len++] = *s++;
+    return len;
+}
+
+
+
+/* proc_putu
+ *
+ * Append an unsigned decimal number, right aligned in width characters.
+ * Inputs: the buffer, the current length, the size of the buffer, the number and the width
+ * Outputs: the new length
+ * Side Effects: None
+ */
+int32_t proc_putu(uint8_t* buf, int32_t len, int32_t size, uint32_t value, int32_t width) {
+    int8_t num[11];     // 2^32 has 10 digits
+    itoa(value, num, 10);
+    int32_t pad = width - (int32_t)strlen(num);
+    while (pad-- > 0 && len < size) buf[len++] = ' ';
+    return proc_puts(buf, len, size, num);
+}
+
+
+
+/* proc_putx
+ *
+ * Append an unsigned hexadecimal number with the 0x prefix.
+ * Inputs: the buffer, the current length, the size of the buffer and the number
+ * Outputs: the new length
+ * Side Effects: None
+ */
+int32_t proc_putx(uint8_t* buf, int32_t len, int32_t size, uint32_t value) {
+    int8_t num[9];      // 2^32 has 8 hex digits
+    itoa(value, num, 16);
+    len = proc_puts(buf, len, size, (int8_t*)"0x");
+    return proc_puts(buf, len, size, num);
+}
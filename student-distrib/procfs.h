@@ -0,0 +1,38 @@
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#include "types.h"
+
+
+
+#define PROCFS_MAX          8           // the maximum number of proc files
+#define PROCFS_BUF_SIZE     0x2000      // the maximum size of the text of one proc file
+
+struct dentry;      // filesys.h
+
+
+
+/*
+ *  a proc file has no data on the disk, show() writes its current
+ *  text into buf (at most size bytes) and returns the length
+ */
+typedef struct proc_entry{
+    const int8_t* name;
+    int32_t (*show)(uint8_t* buf, int32_t size);
+} proc_entry_t;
+
+
+
+int32_t procfs_register(const int8_t* name, int32_t (*show)(uint8_t*, int32_t));
+int32_t procfs_lookup(const uint8_t* fname, struct dentry* dentry);
+int32_t proc_open(const uint8_t* filename);
+int32_t proc_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t proc_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t proc_close(int32_t fd);
+
+// helpers for show() functions
+int32_t proc_puts(uint8_t* buf, int32_t len, int32_t size, const int8_t* s);
+int32_t proc_putu(uint8_t* buf, int32_t len, int32_t size, uint32_t value, int32_t width);
+int32_t proc_putx(uint8_t* buf, int32_t len, int32_t size, uint32_t value);
+
+#endif
@@ -4,10 +4,39 @@
 #include "library/lib.h"
 #include "library/cursor.h"
 #include "paging.h"
+#include "library/pool.h"
 #include "library/dynamic_allocation.h"
+#include "vga.h"
+#include "ldisc.h"
+#include "process.h"
+
+extern int32_t running_process;     // records the current running process, -1 indicates no running process
 
 
 int32_t terminal_switched = 0;
+static pool_t history_pool;     // the lines of the command history of all the terminals
+static uint8_t history_lines[TERMINAL_NUM * HISTORY_LEN][BUFFER_SIZE];
+
+
+
+/*
+ * uint8_t* history_line(terminal_t* terminal)
+ * inputs:          the terminal
+ * return value:    a line for the next command of its history
+ * outputs:         a full history gives up its oldest line
+ * notes:           never fails, the pool holds HISTORY_LEN lines per terminal
+ */
+static uint8_t* history_line(terminal_t* terminal){
+    int32_t i;      // loop index
+    if (terminal->history_num < HISTORY_LEN) return POOL_GET(&history_pool, uint8_t);
+
+    uint8_t* line = terminal->history[0];
+    for (i = 1; i < HISTORY_LEN; ++i){
+        terminal->history[i - 1] = terminal->history[i];
+    }
+    terminal->history_num--;
+    return line;
+}
 
 
 /*
@@ -46,13 +75,28 @@ int32_t terminal_close(int32_t fd){
 int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes){
     running_terminal->flag_function = 1;            // tell the keyboard handler the current environment is terminal
     if (buf == NULL) return -1; // check the pointer validity
-    int32_t i;      // loop index
-    for (i = 0; i < nbytes; ++i){
-        if (*(uint8_t*)(buf + i) == '\0') continue;     // ignore '\0'
-        putc(*(uint8_t*)(buf + i));
-    }
+    if (nbytes < 0) nbytes = 0;
+    putbuf((const int8_t*)buf, nbytes);             // '\0' is ignored by putbuf
     running_terminal->flag_function = 0;            // tell the keyboard handler the writing is over 
-    return i;
+    return nbytes;
+}
+
+
+
+/*
+ * int32_t terminal_writev (int32_t fd, const iovec_t* iov, int32_t iovcnt)
+ * inputs:          iov is the array of source buffers and iovcnt is the number of buffers
+ * return value:    the total number of bytes written to the screen
+ * outputs:         put the contents of all the buffers onto screen in order
+ * notes:           the vector is rendered by one putbufv call with interrupts off,
+ *                  so no echo of the keyboard lands in between two buffers
+ */
+int32_t terminal_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt){
+    if (iov == NULL) return -1; // check the pointer validity
+    running_terminal->flag_function = 1;            // tell the keyboard handler the current environment is terminal
+    int32_t total = putbufv(iov, iovcnt);           // '\0' is ignored by putbufv
+    running_terminal->flag_function = 0;            // tell the keyboard handler the writing is over 
+    return total;
 }
 
 
@@ -60,18 +104,32 @@ int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes){
 /*
  * void terminal_read (int32_t fd, const void* buf, int32_t nbytes)
  * inputs:          buf is the destination buffer and nbytes is the required number of bytes to be read
- * return value:    the number of bytes read from the keyboard buffer, including '\0'
- * outputs:         copy the contents of the keyboard buffer into the destination buf
- * notes:           
+ * return value:    the number of bytes read from the keyboard buffer, including '\n'
+ * outputs:         copy the input line into the destination buf, or in raw mode the keys typed so far
+ * notes:           a raw read waits for the first key only
  */
 int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes){
     cli();
     if (buf == NULL) return -1; // check the pointer validity
-    int32_t i;      // loop index
+    if (nbytes <= 0){
+        sti();
+        return 0;
+    }
+    int32_t i;      // the length of the line
+
+    if (get_PCB(running_process)->tty_mode == TTY_RAW){
+        running_terminal->flag_function = 1;    // tell the keyboard handler the current environment is terminal
+        sti();
+        while (running_terminal->raw_head == running_terminal->raw_tail);
+        cli();
+        i = ldisc_raw_read(running_terminal, buf, nbytes);
+        running_terminal->flag_function = 0;
+        sti();
+        return i;
+    }
+
     if (running_terminal->read_count != 0){
-        for (i = 0; i < running_terminal->read_count; ++i){
-            putc(running_terminal->keyboard_buf[i]);
-        }
+        putbuf((const int8_t*)running_terminal->keyboard_buf, running_terminal->read_count);
     }
     running_terminal->flag_function = 1;    // tell the keyboard handler the current environment is terminal
     running_terminal->input_done = 0;       // tell the keyboard handler the input has not finished
@@ -79,31 +137,21 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes){
     // wait until the input is all typed in
     while (display_terminal != running_terminal || running_terminal->input_done == 0);  
     cli();  
-    for (i = 0; i < nbytes; ++i){   // copy the contents of keyboard_buffer into the buf
-        *(uint8_t*)(buf + i) = display_terminal->keyboard_buf[i]; 
-        *(uint8_t*)(display_terminal->history[display_terminal->history_num] + i) = display_terminal->keyboard_buf[i]; 
-        if (display_terminal->keyboard_buf[i] == '\n'){
-            ++i;
-            break;
-        } 
-    }
+    int32_t len = ldisc_line_len(display_terminal);
+    i = (len < nbytes) ? len : nbytes;
+    memcpy(buf, display_terminal->keyboard_buf, i);
+
+    // the history keeps the start of a long line, it still ends with '\n'
+    uint8_t* line = history_line(display_terminal);
+    if (len > BUFFER_SIZE) len = BUFFER_SIZE;
+    memcpy(line, display_terminal->keyboard_buf, len);
+    line[len - 1] = '\n';
     clear_keyboard_buffer();    // clear the keyboard_buffer
     display_terminal->flag_function = 0;            // tell the keyboard handler the reading is over 
 
     // update the command history
-    display_terminal->history_num++;
+    display_terminal->history[display_terminal->history_num++] = line;
     display_terminal->history_index = display_terminal->history_num - 1;  
-    if (display_terminal->history_num == display_terminal->history_size){
-        void* temp_ptr;
-        temp_ptr = realloc((void*)display_terminal->history, display_terminal->history_size * BUFFER_SIZE * 2);
-        if (temp_ptr == NULL){
-            printf("Command history overflow, please clear the buffer.\n");
-        }
-        else{
-            display_terminal->history = (uint8_t (*)[BUFFER_SIZE])temp_ptr;
-            display_terminal->history_size = 2 * display_terminal->history_size;
-        }
-    }
     sti();     
     return i;
 }
@@ -119,22 +167,27 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes){
  */
 int32_t terminal_init(){
     int i;
+    pool_init(&history_pool, (int8_t*)"history", history_lines, BUFFER_SIZE, TERMINAL_NUM * HISTORY_LEN);
     //initialize terminal 
     for(i = 0; i < TERMINAL_NUM; i++){
-        terminal_array[i].read_count = 0;
         terminal_array[i].flag_function = 0;
         terminal_array[i].screen_x = 0;
         terminal_array[i].screen_y = 0;
-        terminal_array[i].video_mem_buf = VIDEO_MEM_ADDR + (i + 1) * SIZE_4KB;
+        terminal_array[i].video_mem_buf = VIDEO_MEM_ADDR + i * VIDEO_REGION;
+        terminal_array[i].origin = 0;
         terminal_array[i].input_done = 0;
         terminal_array[i].tid = i;
         terminal_array[i].pid = -1;
-        terminal_array[i].history = (uint8_t (*)[BUFFER_SIZE])malloc(BUFFER_SIZE * 10);
         terminal_array[i].history_num = 0;
         terminal_array[i].history_index = -1;
-        terminal_array[i].history_size = 10;
+        terminal_array[i].scrollback = malloc(SCROLLBACK_LINES * NUM_COLS * 2);
+        terminal_array[i].sb_head = 0;
+        terminal_array[i].sb_count = 0;
+        terminal_array[i].sb_view = 0;
     }
 
+    ldisc_init();
+
     //initialize running_terminal pointer and display_terminal pointer to first terminal
     running_terminal = &terminal_array[0];
     display_terminal = &terminal_array[0];
@@ -154,19 +207,11 @@ int32_t terminal_init(){
 void terminal_color_init(){
     //initialize the video memory for each terminal
     current_color = 0;
-    terminal_video();
     clear();
-    for(current_color = 1; current_color < 3; ++current_color){ // 3 terminals in total
-        terminal_backup(current_color);
-        int32_t i;
-        extern char* video_mem;
-        for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-            *(uint8_t *)(video_mem + (i << 1)) = ' ';
-            *(uint8_t *)(video_mem + (i << 1) + 1) = color_scheme[current_color];
-        }
+    for(current_color = 1; current_color < TERMINAL_NUM; ++current_color){
+        memset_word((void*)terminal_array[current_color].video_mem_buf, (color_scheme[current_color] << 8) | ' ', SCREEN_CELLS);
     }
     current_color = -1;
-    terminal_video();
 }
 
 
@@ -186,26 +231,13 @@ void terminal_switch(int32_t new_ter){
         return;
     }
 
-    if (running_terminal == display_terminal){  // virtual video memory maps to the physical video memory
-        // store display terminal information
-        memcpy((void*)(display_terminal->video_mem_buf), (const void*)VIDEO_MEM_ADDR, SIZE_4KB);
-
-        // copy the content of backup memory to the physical videomemory
-        memcpy((void*)VIDEO_MEM_ADDR, (const void*)terminal_array[new_ter].video_mem_buf, SIZE_4KB);
-        terminal_backup(display_terminal->tid);
-    }
-    else{                                       // virtual video memory maps to one of the backup memories
-        // copy the content of backup memory to the physical videomemory
-        terminal_video();
-        // store display terminal information
-        memcpy((void*)(display_terminal->video_mem_buf), (const void*)VIDEO_MEM_ADDR, SIZE_4KB);
-        memcpy((void*)VIDEO_MEM_ADDR, (const void*)terminal_array[new_ter].video_mem_buf, SIZE_4KB);
-        terminal_backup(running_terminal->tid);
-    }
-
-    // update current terminal
+    // leave the scrollback, every terminal always draws into its own video memory,
+    // so showing another one only moves the CRTC start address
+    display_terminal->sb_view = 0;
     display_terminal = &terminal_array[new_ter];
     terminal_switched = 1;
+    vga_terminal_switch(new_ter);      // mode 13h is only set while the terminal of its program is shown
+    set_display_start(DISPLAY_START(display_terminal));
     switch_cursor(display_terminal->screen_x, display_terminal->screen_y);
     sti();
 }
@@ -223,6 +255,7 @@ void search_history(int32_t flag){
     int32_t i;      // loop index
 
     if (display_terminal->history_index == -1 && flag == 1) return;
+    if (ldisc_raw(display_terminal)) return;    // a raw program has no command line
 
     // delete all the characters shown on the screen
     if (display_terminal->read_count != 0){
@@ -230,16 +263,16 @@ void search_history(int32_t flag){
             deletec(0);
         }
     }
+    clear_keyboard_buffer();
 
     // get history
     if (flag == 1){ // get previous command
         i = 0;
         while (display_terminal->history[display_terminal->history_index][i] != '\n'){
+            ldisc_putc(display_terminal, display_terminal->history[display_terminal->history_index][i]);
             putc_visible(display_terminal->history[display_terminal->history_index][i]);
-            display_terminal->keyboard_buf[i] = display_terminal->history[display_terminal->history_index][i];
             i++;
         }
-        display_terminal->read_count = i;
         if (display_terminal->history_index != 0){
             display_terminal->history_index--;
         }
@@ -250,14 +283,10 @@ void search_history(int32_t flag){
             display_terminal->history_index++;
             i = 0;
             while (display_terminal->history[display_terminal->history_index][i] != '\n'){
+                ldisc_putc(display_terminal, display_terminal->history[display_terminal->history_index][i]);
                 putc_visible(display_terminal->history[display_terminal->history_index][i]);
-                display_terminal->keyboard_buf[i] = display_terminal->history[display_terminal->history_index][i];
                 i++;
             }
-            display_terminal->read_count = i;
-        }
-        else{
-            display_terminal->read_count = 0;
         }
     }
 }
@@ -269,12 +298,89 @@ void search_history(int32_t flag){
  * inputs:          none
  * return value:    none
  * outputs:         clear the command history
- * notes:           
+ * notes:           the lines go back to the pool
  */
 void clear_history(){
+    int32_t i;      // loop index
+    for (i = 0; i < display_terminal->history_num; ++i){
+        pool_put(&history_pool, display_terminal->history[i]);
+    }
     display_terminal->history_index = -1;
     display_terminal->history_num = 0;
-    display_terminal->history_size = 10;
-    free(display_terminal->history);
-    display_terminal->history = (uint8_t (*)[BUFFER_SIZE])malloc(BUFFER_SIZE * 10);
+}
+
+
+
+/*
+ * uint16_t* scrollback_push(terminal_t* terminal)
+ * inputs:          the terminal
+ * return value:    the slot for a line leaving the top of the screen, NULL without scrollback
+ * outputs:         the oldest line is overwritten once the ring is full
+ * notes:           the caller copies NUM_COLS cells into the slot
+ */
+uint16_t* scrollback_push(terminal_t* terminal){
+    if (terminal->scrollback == NULL) return NULL;
+    uint16_t* line = terminal->scrollback + terminal->sb_head * NUM_COLS;
+    if (++terminal->sb_head == SCROLLBACK_LINES) terminal->sb_head = 0;
+    if (terminal->sb_count < SCROLLBACK_LINES) terminal->sb_count++;
+    return line;
+}
+
+
+
+/*
+ * uint16_t* scrollback_line(terminal_t* terminal, int32_t back)
+ * inputs:          the terminal, and back, 1 for the newest line
+ * return value:    the cells of the line, NULL if the ring does not go back that far
+ * outputs:         none
+ * notes:
+ */
+uint16_t* scrollback_line(terminal_t* terminal, int32_t back){
+    if (terminal->scrollback == NULL || back < 1 || back > terminal->sb_count) return NULL;
+    int32_t slot = terminal->sb_head - back;
+    if (slot < 0) slot += SCROLLBACK_LINES;
+    return terminal->scrollback + slot * NUM_COLS;
+}
+
+
+
+/*
+ * void scrollback_scroll(int32_t lines)
+ * inputs:          the lines to move the display terminal back, negative to move forward
+ * return value:    none
+ * outputs:         show the scrollback of the display terminal
+ * notes:           the view is drawn into the spare page VIDEO_VIEW and shown by moving the
+ *                  CRTC start address, so the screen and the running program are not touched.
+ *                  Output keeps going to the screen, the view is redrawn by the next key
+ */
+void scrollback_scroll(int32_t lines){
+    uint32_t flags;
+    int32_t row;    // loop index
+    terminal_t* terminal = display_terminal;
+
+    cli_and_save(flags);
+    if (vga_graphics){          // the screen shows the frame buffer
+        restore_flags(flags);
+        return;
+    }
+    int32_t view = terminal->sb_view + lines;
+    if (view > terminal->sb_count) view = terminal->sb_count;
+    if (view < 0) view = 0;
+    terminal->sb_view = view;
+
+    if (view == 0){
+        set_display_start(DISPLAY_START(terminal));
+        switch_cursor(terminal->screen_x, terminal->screen_y);
+        restore_flags(flags);
+        return;
+    }
+
+    uint16_t* screen = (uint16_t*)terminal->video_mem_buf + terminal->origin;
+    for (row = 0; row < NUM_ROWS; ++row){
+        uint16_t* src = (row < view) ? scrollback_line(terminal, view - row) : screen + (row - view) * NUM_COLS;
+        memcpy((uint16_t*)VIDEO_VIEW + row * NUM_COLS, src, NUM_COLS * 2);
+    }
+    // the cursor stays on the screen, which is not shown now
+    set_display_start((VIDEO_VIEW - VIDEO_MEM_ADDR) / 2);
+    restore_flags(flags);
 }
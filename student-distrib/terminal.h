@@ -5,10 +5,14 @@
 
 #define BUFFER_SIZE         128
 #define TERMINAL_NUM        3
+#define HISTORY_LEN         32          // commands remembered by each terminal, the oldest is dropped
+#define SCROLLBACK_LINES    256         // lines kept by each terminal after they scroll off the screen
+#define RAW_RING_SIZE       256         // keys a raw terminal keeps until they are read, must be a power of 2
 
 int32_t terminal_open(const uint8_t* filename);
 int32_t terminal_close(int32_t fd);
 int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t terminal_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
 int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes);
 int32_t terminal_init();
 void terminal_color_init();
@@ -27,18 +31,27 @@ typedef struct terminal
     *   1 --- terminal
     */
     uint8_t flag_function;
-    uint8_t keyboard_buf[BUFFER_SIZE];
-    uint8_t read_count;
+    uint8_t* keyboard_buf;      // the input line, line_inline or a long line from the line discipline, '\0' terminated
+    int32_t buf_size;           // the size of keyboard_buf
+    int32_t read_count;         // characters in the input line
+    uint8_t line_inline[BUFFER_SIZE];
+    uint8_t raw_ring[RAW_RING_SIZE];    // the keys of a program in raw mode
+    volatile uint32_t raw_head; // both only grow, the ring holds [raw_tail, raw_head)
+    volatile uint32_t raw_tail;
     int32_t tid;
     volatile int32_t input_done;
     int screen_x;
     int screen_y;
     int32_t pid;
-    uint32_t video_mem_buf;     //video memory buffer
-    uint8_t (*history)[BUFFER_SIZE];
+    uint32_t video_mem_buf;     // the start of the VIDEO_REGION of video memory of the terminal
+    int32_t origin;             // the cell of the top line of the screen in video_mem_buf
+    uint8_t* history[HISTORY_LEN];      // lines from history_pool, the oldest first
     int32_t history_num;
     int32_t history_index;
-    int32_t history_size;
+    uint16_t* scrollback;       // SCROLLBACK_LINES lines of cells from the heap, a ring, NULL if there was no memory
+    int32_t sb_head;            // the slot of the next line
+    int32_t sb_count;           // lines in the ring
+    int32_t sb_view;            // how many lines the display is moved back, 0 shows the screen
 
 }terminal_t;
 
@@ -48,5 +61,9 @@ terminal_t terminal_array[TERMINAL_NUM];
 terminal_t* running_terminal;   //running terminal
 terminal_t* display_terminal;   //display terminal
 
+uint16_t* scrollback_push(terminal_t* terminal);
+uint16_t* scrollback_line(terminal_t* terminal, int32_t back);
+void scrollback_scroll(int32_t lines);
+
 
 #endif
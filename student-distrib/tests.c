@@ -12,6 +12,15 @@
 #include "interrupt/rtc.h"
 #include "interrupt/sb16.h"
 #include "library/dynamic_allocation.h"
+#include "interrupt/syscall_stats.h"
+#include "buddy.h"
+#include "library/pool.h"
+#include "klog.h"
+#include "procfs.h"
+#include "ldisc.h"
+#include "kthread.h"
+#include "workqueue.h"
+#include "interrupt/keyboard.h"
 
 #define PASS 1
 #define FAIL 0
@@ -848,6 +857,414 @@ int play_wav_test(){
 	return PASS;
 }
 
+/* stats_row
+ * a helper function, parse the row of a system call in the [all] table of
+ * the proc file "syscalls"
+ * Inputs: text -- the proc text, '\0' terminated
+ *         name -- the system call
+ *         row -- gets the count, then the SYSCALL_HIST_BUCKETS buckets,
+ *                all 0 if the call has no row yet
+ * Outputs: None
+ * Side Effects: None
+ */
+static void stats_row(uint8_t* text, int8_t* name, uint32_t* row){
+	int32_t i, j;
+	int32_t len = strlen(name);
+	for (j = 0; j <= SYSCALL_HIST_BUCKETS; ++j) row[j] = 0;
+
+	// every line starts with the name padded by spaces, the first match is in [all]
+	for (i = 0; text[i] != '\0'; ++i){
+		if ((i == 0 || text[i - 1] == '\n') && strncmp((int8_t*)text + i, name, len) == 0 && text[i + len] == ' ') break;
+	}
+	if (text[i] == '\0') return;
+	i += len;
+	for (j = 0; j <= SYSCALL_HIST_BUCKETS; ++j){
+		while (text[i] == ' ' || text[i] == '|') i++;
+		while (text[i] >= '0' && text[i] <= '9') row[j] = row[j] * 10 + (text[i++] - '0');
+	}
+}
+
+/* syscall_stats_test
+ * 
+ * Record two fake read calls, check that the read row of the proc file
+ * counts two more calls, one more in bucket 0 and one more in bucket 6,
+ * then read the whole file through the file system.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the global system call table counts two more reads
+ * Coverage: interrupt/syscall_stats.c, procfs.c
+ */
+int syscall_stats_test(){
+	TEST_HEADER;
+
+	int32_t fd, len, total, j;
+	uint8_t buf[256];
+	static uint8_t text[PROCFS_BUF_SIZE];
+	uint32_t before[SYSCALL_HIST_BUCKETS + 1];
+	uint32_t after[SYSCALL_HIST_BUCKETS + 1];
+	fd_t tmp_fd_array[MAX_FILES];
+	init_fd(tmp_fd_array);
+
+	len = syscall_stats_show(text, sizeof(text) - 1);
+	text[len] = '\0';
+	stats_row(text, (int8_t*)"read", before);
+
+	syscall_stats_record(3, 100);		// bucket 0, below 2^7 cycles
+	syscall_stats_record(3, 5000);		// bucket 6, [2^12, 2^13) cycles
+
+	len = syscall_stats_show(text, sizeof(text) - 1);
+	text[len] = '\0';
+	stats_row(text, (int8_t*)"read", after);
+	if (after[0] != before[0] + 2) return FAIL;
+	for (j = 0; j < SYSCALL_HIST_BUCKETS; ++j){
+		uint32_t added = (j == 0 || j == 6) ? 1 : 0;
+		if (after[j + 1] != before[j + 1] + added) return FAIL;
+	}
+
+	fd = open((uint8_t*)"syscalls");
+	if (fd == -1) return FAIL;
+	total = 0;
+	while ((len = read(fd, buf, sizeof(buf))) > 0){
+		write(1, buf, len);
+		total += len;
+	}
+	close(fd);
+	if (len != 0 || total == 0) return FAIL;
+
+	// only the exact name opens the proc file
+	if (open((uint8_t*)"syscall") != -1) return FAIL;
+	return PASS;
+}
+
+/* buddy_test
+ * 
+ * Allocate blocks of every order, check that they are aligned and do not
+ * overlap, then free them and check that all the pages came back.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: buddy.c
+ */
+int buddy_test(){
+	TEST_HEADER;
+
+	uint32_t block[BUDDY_MAX_ORDER + 1];
+	int32_t before = buddy_free_pages();
+	int32_t i, j;
+	int32_t result = PASS;
+
+	for (i = 0; i <= BUDDY_MAX_ORDER; ++i){
+		block[i] = buddy_alloc(i);
+		if (block[i] == 0) return FAIL;
+		if (block[i] & ((BUDDY_PAGE_SIZE << i) - 1)) result = FAIL;		// aligned to its size
+		if (block[i] < BUDDY_RESERVED) result = FAIL;
+		for (j = 0; j < i; ++j){
+			if (block[j] < block[i] + (BUDDY_PAGE_SIZE << i) &&
+				block[i] < block[j] + (BUDDY_PAGE_SIZE << j)) result = FAIL;
+		}
+	}
+	if (buddy_free_pages() != before - ((1 << (BUDDY_MAX_ORDER + 1)) - 1)) result = FAIL;
+	if (buddy_free(block[0] + BUDDY_PAGE_SIZE) != -1) result = FAIL;		// not a block
+
+	for (i = 0; i <= BUDDY_MAX_ORDER; ++i){
+		if (buddy_free(block[i]) != 0) result = FAIL;
+	}
+	if (buddy_free(block[0]) != -1) result = FAIL;		// freed twice
+	if (buddy_free_pages() != before) result = FAIL;
+
+	return result;
+}
+
+#define STRING_TEST_ROUNDS	20000
+#define STRING_TEST_SIZE	64
+
+/* the byte at a time versions the word at a time ones in lib.c replaced */
+static uint32_t ref_strlen(const int8_t* s){
+	uint32_t len = 0;
+	while (s[len] != '\0') len++;
+	return len;
+}
+
+static int32_t ref_strncmp(const int8_t* s1, const int8_t* s2, uint32_t n){
+	int32_t i;
+	for (i = 0; i < n; i++){
+		if ((s1[i] != s2[i]) || (s1[i] == '\0')) return s1[i] - s2[i];
+	}
+	return 0;
+}
+
+static int8_t* ref_strncpy(int8_t* dest, const int8_t* src, uint32_t n){
+	int32_t i = 0;
+	while (src[i] != '\0' && i < n){
+		dest[i] = src[i];
+		i++;
+	}
+	while (i < n){
+		dest[i] = '\0';
+		i++;
+	}
+	return dest;
+}
+
+/* fill a string of random length with random bytes, some of them negative */
+static void random_string(int8_t* s, int32_t max){
+	int32_t i;
+	int32_t len = rand() % max;
+	for (i = 0; i < len; ++i){
+		s[i] = rand() % 255 + 1;
+	}
+	s[len] = '\0';
+}
+
+/* String Test
+ *
+ * Compare strlen, strncmp, strcpy and strncpy with the old byte at a time
+ * versions on random strings, at every alignment of source and destination.
+ * The bytes behind the destination must stay untouched.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: lib.c
+ */
+int string_test(){
+	TEST_HEADER;
+
+	static int8_t a[STRING_TEST_SIZE + 8], b[STRING_TEST_SIZE + 8];
+	static int8_t out1[STRING_TEST_SIZE + 8], out2[STRING_TEST_SIZE + 8];
+	int32_t round, i, n;
+	int32_t result = PASS;
+
+	for (round = 0; round < STRING_TEST_ROUNDS; ++round){
+		int8_t* s1 = a + rand() % 4;
+		int8_t* s2 = b + rand() % 4;
+		int32_t off = rand() % 4;
+		random_string(s1, STRING_TEST_SIZE);
+		// s2 is often a prefix of s1 or differs in a single byte
+		strcpy(s2, s1);
+		if (rand() % 2) s2[rand() % (strlen(s1) + 1)] = rand() % 256;
+		n = rand() % (STRING_TEST_SIZE + 4);
+
+		if (strlen(s1) != ref_strlen(s1)) result = FAIL;
+		if (strncmp(s1, s2, n) != ref_strncmp(s1, s2, n)) result = FAIL;
+		if (strncmp(s2, s1, n) != ref_strncmp(s2, s1, n)) result = FAIL;
+
+		for (i = 0; i < STRING_TEST_SIZE + 8; ++i) out1[i] = out2[i] = 0x5A;
+		if (strcpy(out1 + off, s1) != out1 + off) result = FAIL;
+		for (i = 0; i <= ref_strlen(s1); ++i) out2[off + i] = s1[i];
+		for (i = 0; i < STRING_TEST_SIZE + 8; ++i){
+			if (out1[i] != out2[i]) result = FAIL;
+		}
+
+		n = rand() % STRING_TEST_SIZE;
+		for (i = 0; i < STRING_TEST_SIZE + 8; ++i) out1[i] = out2[i] = 0x5A;
+		if (strncpy(out1 + off, s1, n) != out1 + off) result = FAIL;
+		ref_strncpy(out2 + off, s1, n);
+		for (i = 0; i < STRING_TEST_SIZE + 8; ++i){
+			if (out1[i] != out2[i]) result = FAIL;
+		}
+		if (result == FAIL) break;
+	}
+	return result;
+}
+
+/* Pool Test
+ *
+ * Empty a small pool, check that the objects are distinct and inside the
+ * storage, then put them back and check the LIFO order and the statistics.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: pool.c
+ */
+int pool_test(){
+	TEST_HEADER;
+
+	static pool_t pool;
+	static uint32_t storage[4][4];
+	uint32_t* obj[4];
+	int32_t i;
+	int32_t result = PASS;
+
+	pool_init(&pool, (int8_t*)"test", storage, sizeof(storage[0]), 4);
+	for (i = 0; i < 4; ++i){
+		obj[i] = POOL_GET(&pool, uint32_t);
+		if (obj[i] != storage[i]) result = FAIL;			// the first object comes first
+		if (pool_index(&pool, obj[i]) != i) result = FAIL;
+	}
+	if (pool_get(&pool) != NULL) result = FAIL;			// empty
+	if (pool.in_use != 4 || pool.peak != 4 || pool.fails != 1) result = FAIL;
+
+	if (pool_put(&pool, (uint8_t*)obj[1] + 4) != -1) result = FAIL;	// not an object
+	if (pool_put(&pool, obj[2]) != 0 || pool_put(&pool, obj[0]) != 0) result = FAIL;
+	if (pool_get(&pool) != obj[0]) result = FAIL;			// last in, first out
+	if (pool.in_use != 3) result = FAIL;
+
+	return result;
+}
+
+/* klog_test
+ * 
+ * Log more messages than the ring keeps, check that kmsg shows exactly the
+ * newest KLOG_RECORDS of them, the last one at the end.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the kernel log is full of test messages
+ * Coverage: klog.c
+ */
+int klog_test(){
+	TEST_HEADER;
+
+	static uint8_t buf[PROCFS_BUF_SIZE];
+	int8_t last[KLOG_TEXT];
+	int32_t i, len, lines, n;
+
+	for (i = 0; i < KLOG_RECORDS + 3; ++i){
+		if (klog(KLOG_DEBUG, "klog_test %d of %d", i, KLOG_RECORDS + 3) <= 0) return FAIL;
+	}
+	len = klog_show(buf, sizeof(buf));
+	lines = 0;
+	for (i = 0; i < len; ++i){
+		if (buf[i] == '\n') lines++;
+	}
+	if (lines != KLOG_RECORDS) return FAIL;
+
+	n = snprintf(last, sizeof(last), "klog_test %d of %d\n", KLOG_RECORDS + 2, KLOG_RECORDS + 3);
+	if (len < n || strncmp((int8_t*)buf + len - n, last, n) != 0) return FAIL;
+
+	// a message longer than a record is cut
+	for (i = 0; i < KLOG_TEXT; ++i) last[i] = 'a';
+	last[KLOG_TEXT - 1] = '\0';
+	if (klog(KLOG_DEBUG, "%s%s", last, last) != 2 * (KLOG_TEXT - 1)) return FAIL;
+	return PASS;
+}
+
+/* ldisc_test
+ * 
+ * Type a line longer than BUFFER_SIZE into a terminal which is not used,
+ * check that it moves to a long line buffer and still ends with '\n', then
+ * fill and drain the raw ring. Last, a 200 character command line is split
+ * by parse_command the way execute does it.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: ldisc.c
+ */
+int ldisc_test(){
+	TEST_HEADER;
+
+	static terminal_t t;
+	static uint8_t command[LINE_MAX];
+	static uint8_t arg[LINE_MAX];
+	uint8_t file_name[MAX_FILENAME_LEN + 1];
+	uint8_t keys[RAW_RING_SIZE];
+	int32_t i;
+	int32_t result = PASS;
+
+	t.pid = -1;
+	t.keyboard_buf = t.line_inline;
+	t.buf_size = BUFFER_SIZE;
+	ldisc_flush(&t);
+
+	for (i = 0; i < 2 * BUFFER_SIZE; ++i){
+		if (ldisc_putc(&t, 'a' + i % 26) != 0) result = FAIL;
+	}
+	if (t.buf_size != LINE_MAX || t.keyboard_buf == t.line_inline) result = FAIL;
+	ldisc_erase(&t);
+	if (ldisc_putc(&t, '\n') != 0) result = FAIL;
+	if (ldisc_line_len(&t) != 2 * BUFFER_SIZE) result = FAIL;
+	for (i = 0; i < 2 * BUFFER_SIZE - 1; ++i){
+		if (t.keyboard_buf[i] != 'a' + i % 26) result = FAIL;
+	}
+	ldisc_reset(&t);
+	if (t.keyboard_buf != t.line_inline || t.read_count != 0) result = FAIL;
+
+	// the ring keeps RAW_RING_SIZE keys and drops the rest
+	for (i = 0; i < RAW_RING_SIZE + 3; ++i) ldisc_raw_put(&t, i);
+	if (ldisc_raw_read(&t, keys, 3) != 3 || keys[2] != 2) result = FAIL;
+	if (ldisc_raw_read(&t, keys, RAW_RING_SIZE) != RAW_RING_SIZE - 3) result = FAIL;
+	if (keys[0] != 3 || ldisc_raw_read(&t, keys, 1) != 0) result = FAIL;
+
+	// a 200 character command line reaches execute whole
+	for (i = 0; i < 4; ++i) ldisc_putc(&t, "cat "[i]);
+	for (i = 4; i < 200; ++i) ldisc_putc(&t, 'a' + i % 26);
+	ldisc_putc(&t, '\n');
+	i = ldisc_line_len(&t);
+	memcpy(command, t.keyboard_buf, i);
+	command[i - 1] = '\0';
+	if (i != 201 || parse_command(command, file_name, arg) != 0) result = FAIL;
+	if (strncmp((int8_t*)file_name, (int8_t*)"cat", 4) != 0 || strlen((int8_t*)arg) != 196) result = FAIL;
+	if (arg[0] != 'e' || arg[195] != 'a' + 199 % 26) result = FAIL;
+	ldisc_reset(&t);
+	return result;
+}
+
+/* keyboard_preempt_test
+ * 
+ * Emulate the worker being preempted by the PIT between two scancodes,
+ * the test plays the keyboard interrupt, the worker and schedule(). A
+ * started thread which did not yield must be picked again although its
+ * queue is empty, and a key typed meanwhile must still be decoded.
+ * Run it before workqueue_init, the released keys do not echo anything.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: kthread.c, keyboard.c
+ */
+static int32_t preempt_test_work = 0;
+static int32_t preempt_test_runnable(void){
+	return preempt_test_work;
+}
+static void preempt_test_entry(void* arg){
+}
+int keyboard_preempt_test(){
+	TEST_HEADER;
+
+	uint32_t flags;
+	kthread_t* t;
+	int32_t result = PASS;
+
+	cli_and_save(flags);
+	if (kthread_create(preempt_test_entry, NULL, preempt_test_runnable) == -1){
+		restore_flags(flags);
+		return FAIL;
+	}
+	preempt_test_work = 1;
+	t = kthread_pick();
+	preempt_test_work = 0;
+	if (t == NULL || t->runnable != preempt_test_runnable){
+		restore_flags(flags);
+		return FAIL;
+	}
+
+	// schedule() started the thread, it took its work and the PIT took the CPU back
+	t->state = KTHREAD_READY;
+	t->yielded = 0;
+	if (kthread_pick() != t) result = FAIL;
+	// once it yields it waits for runnable() again
+	t->yielded = 1;
+	if (kthread_pick() == t) result = FAIL;
+	t->state = KTHREAD_UNUSED;
+
+	// keyboard_work is off the queue once it runs, a key arriving after that queues it again
+	keyboard_scancode(ENTER_P_SC | 0x80);
+	if (!work_pending()) result = FAIL;
+	run_work();
+	cli();           // run_work turns interrupts on
+	if (work_pending()) result = FAIL;
+	// two keys, the worker decodes the first one and is preempted
+	keyboard_scancode(ENTER_P_SC | 0x80);
+	keyboard_scancode(BACKSPACE_SC | 0x80);
+	if (!work_pending()) result = FAIL;
+	if (keyboard_decode_next() != 0) result = FAIL;
+	// resumed, it decodes the second one, then the queued run finds nothing left
+	if (keyboard_decode_next() != 0 || keyboard_decode_next() != -1) result = FAIL;
+	run_work();
+	cli();
+	if (work_pending() || keyboard_decode_next() != -1) result = FAIL;
+	restore_flags(flags);
+	return result;
+}
+
 /* pause
  * a helper function
  * Inputs: None
@@ -894,6 +1311,140 @@ int32_t str2num(uint8_t* buf){
 
 
 
+#define HEAP_BENCH_LIVE		1024
+#define HEAP_BENCH_ROUNDS	100000
+
+/* read the low 32 bits of the time stamp counter */
+static inline uint32_t rdtsc_low(){
+	uint32_t lo, hi;
+	asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return lo;
+}
+
+/* heap_bench
+ * 
+ * Allocation benchmark: keep HEAP_BENCH_LIVE objects alive, then free a
+ * random one and allocate a new one of random size, HEAP_BENCH_ROUNDS times.
+ * One in 16 objects is too big for the slabs.
+ * Inputs: None
+ * Outputs: PASS/FAIL, prints the cycles per operation and operations per second
+ * Side Effects: None, everything is freed at the end
+ * Coverage: library/dynamic_allocation.c
+ */
+int heap_bench(){
+	TEST_HEADER;
+
+	static void* live[HEAP_BENCH_LIVE];
+	uint32_t start, cycles, tsc_hz, per_op;
+	int32_t i, slot, size;
+	int32_t result = PASS;
+	int32_t base_area = heap_info.num_area;
+	fd_t tmp_fd_array[MAX_FILES];
+	init_fd(tmp_fd_array);
+
+	// calibrate the TSC against half a second of the 2 Hz RTC
+	start = rdtsc_low();
+	timer_wait(1);
+	tsc_hz = (rdtsc_low() - start) * 2;
+
+	for (i = 0; i < HEAP_BENCH_LIVE; ++i){
+		size = (i % 16 == 15) ? 2048 + rand() % 4096 : 1 + rand() % 512;
+		live[i] = malloc(size);
+		if (live[i] == NULL) return FAIL;
+	}
+
+	start = rdtsc_low();
+	for (i = 0; i < HEAP_BENCH_ROUNDS; ++i){
+		slot = rand() % HEAP_BENCH_LIVE;
+		size = (i % 16 == 15) ? 2048 + rand() % 4096 : 1 + rand() % 512;
+		free(live[slot]);
+		live[slot] = malloc(size);
+		if (live[slot] == NULL){
+			result = FAIL;
+			break;
+		}
+	}
+	cycles = rdtsc_low() - start;
+
+	for (i = 0; i < HEAP_BENCH_LIVE; ++i){
+		if (live[i] == NULL) continue;
+		if (validate(live[i]) == -1) result = FAIL;
+		free(live[i]);
+	}
+	if (heap_info.num_area != base_area) result = FAIL;
+
+	per_op = cycles / (2 * HEAP_BENCH_ROUNDS);
+	if (per_op == 0) per_op = 1;
+	printf("%d live objects, %d malloc/free pairs\n", HEAP_BENCH_LIVE, HEAP_BENCH_ROUNDS);
+	printf("%d cycles per operation, %d operations per second\n", per_op, tsc_hz / per_op);
+	print_heap_info();
+
+	return result;
+}
+
+
+#define MEM_BENCH_MAX		0x100000		// the biggest copy, 1 MB
+#define MEM_BENCH_BYTES		0x400000		// bytes copied for each size and variant
+
+typedef void* (*mem_copy_t)(void*, const void*, uint32_t);
+
+/* compare n bytes, 0 if they are equal */
+static int32_t memcmp_bench(const uint8_t* a, const uint8_t* b, uint32_t n){
+	uint32_t i;
+	for (i = 0; i < n; ++i){
+		if (a[i] != b[i]) return -1;
+	}
+	return 0;
+}
+
+/* mem_bench
+ * 
+ * Copy benchmark: every memcpy variant the CPU supports copies sizes from
+ * 16 bytes to 1 MB, MEM_BENCH_BYTES bytes in total for each size. The
+ * source and destination are not aligned to each other.
+ * Inputs: None
+ * Outputs: PASS/FAIL, prints the cycles per copy and the bytes per 100 cycles
+ * Side Effects: None, the buffers are freed at the end
+ * Coverage: library/lib.c
+ */
+int mem_bench(){
+	TEST_HEADER;
+
+	static const int8_t* names[3] = {"rep movsl", "rep movsb", "sse2 nt"};
+	mem_copy_t copy[3] = {memcpy_rep_movsl, memcpy_rep_movsb, memcpy_sse2_nt};
+	uint32_t size, rounds, start, cycles;
+	int32_t i, v;
+	int32_t result = PASS;
+
+	uint8_t* src = malloc(MEM_BENCH_MAX + 64);
+	uint8_t* dest = malloc(MEM_BENCH_MAX + 64);
+	if (src == NULL || dest == NULL) return FAIL;
+	for (i = 0; i < MEM_BENCH_MAX + 64; ++i) src[i] = i;
+
+	printf("features:%s%s\n", (mem_features & MEM_ERMS) ? " erms" : "",
+			(mem_features & MEM_SSE2) ? " sse2" : "");
+	for (size = 16; size <= MEM_BENCH_MAX; size <<= 2){
+		printf("%d bytes:", size);
+		for (v = 0; v < 3; ++v){
+			if (v == 2 && !(mem_features & MEM_SSE2)) continue;
+			rounds = MEM_BENCH_BYTES / size;
+			start = rdtsc_low();
+			for (i = 0; i < rounds; ++i) copy[v](dest + 4, src + 1, size);
+			cycles = (rdtsc_low() - start) / rounds;
+			if (cycles == 0) cycles = 1;
+			printf("  %s %d cyc %d B/100cyc", names[v], cycles, size * 100 / cycles);
+			if (memcmp_bench(dest + 4, src + 1, size) != 0) result = FAIL;
+		}
+		printf("\n");
+	}
+
+	free(src);
+	free(dest);
+	return result;
+}
+
+
+
 /* test_DA
  * 
  * Test dynamic allocation.
@@ -903,7 +1454,6 @@ int32_t str2num(uint8_t* buf){
  */
 void test_DA(){
 	current_color = 0;
-	terminal_video();
 
 	uint8_t buffer[128];
 	int32_t num_region = 0;
@@ -978,14 +1528,22 @@ void test_DA(){
 
 void launch_tests(){
 	current_color = 0;
-    terminal_video();
 
 	// TEST_OUTPUT("random_test1", random_test1());
 	// TEST_OUTPUT("random_test2", random_test2());
 	// TEST_OUTPUT("beep_test", beep_test());
 	TEST_OUTPUT("play_wav_test", play_wav_test());
+	// TEST_OUTPUT("syscall_stats_test", syscall_stats_test());
+	// TEST_OUTPUT("buddy_test", buddy_test());
+	// TEST_OUTPUT("pool_test", pool_test());
+	// TEST_OUTPUT("string_test", string_test());
+	// TEST_OUTPUT("klog_test", klog_test());
+	// TEST_OUTPUT("ldisc_test", ldisc_test());
+	// TEST_OUTPUT("keyboard_preempt_test", keyboard_preempt_test());
 
 	// test_DA();
+	// TEST_OUTPUT("heap_bench", heap_bench());
+	// TEST_OUTPUT("mem_bench", mem_bench());
 
 	current_color = -1;
 }
@@ -0,0 +1,357 @@
+#include "vga.h"
+#include "library/lib.h"
+#include "library/cursor.h"
+#include "paging.h"
+#include "process.h"
+#include "terminal.h"
+
+extern int32_t running_process;     // records the current running process, -1 indicates no running process
+
+
+/*
+ *  Mode 13h graphics for one user program at a time.
+ *  The program draws into fb_back, which vidmap_fb maps at FB_START, and
+ *  fb_flip copies it to the screen in the vertical retrace. Mode 13h has a
+ *  single page of video memory, so this copy is the page flip.
+ *  The graphics mode is only set while the terminal of the owner is shown.
+ *  Text mode memory is not reachable then, so the video memory of all the
+ *  terminals moves to text_shadow, and the font, the palette and the text
+ *  mode registers are saved to be put back afterwards.
+ */
+int32_t vga_graphics = 0;                   // 1 while the VGA is in mode 13h
+static int32_t fb_owner = -1;               // the process which has the frame buffer, -1 for none
+static int32_t fb_tid = -1;                 // its terminal
+
+static uint8_t fb_back[FB_PAGES * SIZE_4KB] __attribute__((aligned (SIZE_4KB)));
+static uint8_t text_shadow[VIDEO_MEM_PAGES * SIZE_4KB] __attribute__((aligned (SIZE_4KB)));
+static uint8_t font_save[VGA_FONT_SIZE];
+static uint8_t dac_save[256 * 3];
+static uint8_t text_regs[VGA_NUM_REGS];
+
+// 320x200, 256 colors, chain 4. Refer to Chris Giese's modes.c
+static const uint8_t mode13h_regs[VGA_NUM_REGS] = {
+    /* MISC */
+    0x63,
+    /* SEQ */
+    0x03, 0x01, 0x0F, 0x00, 0x0E,
+    /* CRTC */
+    0x5F, 0x4F, 0x50, 0x82, 0x54, 0x80, 0xBF, 0x1F,
+    0x00, 0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x9C, 0x0E, 0x8F, 0x28, 0x40, 0x96, 0xB9, 0xA3,
+    0xFF,
+    /* GC */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x05, 0x0F,
+    0xFF,
+    /* AC */
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x41, 0x00, 0x0F, 0x00, 0x00
+};
+
+
+
+/*
+ *  uint8_t vga_get (uint16_t index_port, uint8_t index)
+ *  DESCRIPTION: read an indexed register of the sequencer, the CRTC or the GC
+ *  INPUTS:     index_port -- the index port, the data port follows it
+ *              index -- the register
+ *  OUTPUTS:    none
+ *  RETURN VALUE: the value of the register
+ */
+static uint8_t vga_get(uint16_t index_port, uint8_t index){
+    outb(index, index_port);
+    return inb(index_port + 1);
+}
+
+
+
+/*
+ *  void vga_set (uint16_t index_port, uint8_t index, uint8_t value)
+ *  DESCRIPTION: write an indexed register of the sequencer, the CRTC or the GC
+ *  INPUTS:     index_port -- the index port, the data port follows it
+ *              index -- the register
+ *              value -- its new value
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+static void vga_set(uint16_t index_port, uint8_t index, uint8_t value){
+    outb(index, index_port);
+    outb(value, index_port + 1);
+}
+
+
+
+/*
+ *  void vga_read_regs (uint8_t* regs)
+ *  DESCRIPTION: save the registers of the current mode
+ *  INPUTS:     regs -- VGA_NUM_REGS bytes, in the order of mode13h_regs
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+static void vga_read_regs(uint8_t* regs){
+    int32_t i;      // loop index
+    *regs++ = inb(VGA_MISC_READ);
+    for (i = 0; i < VGA_NUM_SEQ; ++i) *regs++ = vga_get(VGA_SEQ_INDEX, i);
+    for (i = 0; i < VGA_NUM_CRTC; ++i) *regs++ = vga_get(VGA_CRTC_INDEX, i);
+    for (i = 0; i < VGA_NUM_GC; ++i) *regs++ = vga_get(VGA_GC_INDEX, i);
+    for (i = 0; i < VGA_NUM_AC; ++i){
+        inb(VGA_INSTAT_READ);
+        outb(i, VGA_AC_INDEX);
+        *regs++ = inb(VGA_AC_READ);
+    }
+    inb(VGA_INSTAT_READ);
+    outb(0x20, VGA_AC_INDEX);       // the palette address source bit, the screen is blank without it
+}
+
+
+
+/*
+ *  void vga_write_regs (const uint8_t* regs)
+ *  DESCRIPTION: set a mode
+ *  INPUTS:     regs -- VGA_NUM_REGS bytes, in the order of mode13h_regs
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+static void vga_write_regs(const uint8_t* regs){
+    int32_t i;      // loop index
+    outb(*regs++, VGA_MISC_WRITE);
+    for (i = 0; i < VGA_NUM_SEQ; ++i) vga_set(VGA_SEQ_INDEX, i, *regs++);
+
+    // unlock CRTC registers 0-7 and keep them unlocked
+    vga_set(VGA_CRTC_INDEX, 0x03, vga_get(VGA_CRTC_INDEX, 0x03) | 0x80);
+    vga_set(VGA_CRTC_INDEX, 0x11, vga_get(VGA_CRTC_INDEX, 0x11) & ~0x80);
+    for (i = 0; i < VGA_NUM_CRTC; ++i){
+        uint8_t value = regs[i];
+        if (i == 0x03) value |= 0x80;
+        if (i == 0x11) value &= ~0x80;
+        vga_set(VGA_CRTC_INDEX, i, value);
+    }
+    regs += VGA_NUM_CRTC;
+
+    for (i = 0; i < VGA_NUM_GC; ++i) vga_set(VGA_GC_INDEX, i, *regs++);
+    for (i = 0; i < VGA_NUM_AC; ++i){
+        inb(VGA_INSTAT_READ);
+        outb(i, VGA_AC_INDEX);
+        outb(*regs++, VGA_AC_INDEX);
+    }
+    inb(VGA_INSTAT_READ);
+    outb(0x20, VGA_AC_INDEX);
+}
+
+
+
+/*
+ *  void vga_font (int32_t restore)
+ *  DESCRIPTION: copy the font in plane 2 to font_save, or back
+ *  INPUTS:     restore -- 0 to save the font, 1 to write it back
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: text mode only, plane 2 is reached through the text window at VIDEO_MEM_ADDR
+ */
+static void vga_font(int32_t restore){
+    uint8_t seq2 = vga_get(VGA_SEQ_INDEX, 2);
+    uint8_t seq4 = vga_get(VGA_SEQ_INDEX, 4);
+    uint8_t gc4 = vga_get(VGA_GC_INDEX, 4);
+    uint8_t gc5 = vga_get(VGA_GC_INDEX, 5);
+    uint8_t gc6 = vga_get(VGA_GC_INDEX, 6);
+
+    // turn off odd/even addressing and select plane 2 for reading and writing
+    vga_set(VGA_SEQ_INDEX, 4, seq4 | 0x04);
+    vga_set(VGA_GC_INDEX, 5, gc5 & ~0x10);
+    vga_set(VGA_GC_INDEX, 6, gc6 & ~0x02);
+    vga_set(VGA_GC_INDEX, 4, 2);
+    vga_set(VGA_SEQ_INDEX, 2, 1 << 2);
+
+    if (restore) memcpy((void*)VIDEO_MEM_ADDR, font_save, VGA_FONT_SIZE);
+    else memcpy(font_save, (void*)VIDEO_MEM_ADDR, VGA_FONT_SIZE);
+
+    vga_set(VGA_SEQ_INDEX, 2, seq2);
+    vga_set(VGA_SEQ_INDEX, 4, seq4);
+    vga_set(VGA_GC_INDEX, 4, gc4);
+    vga_set(VGA_GC_INDEX, 5, gc5);
+    vga_set(VGA_GC_INDEX, 6, gc6);
+}
+
+
+
+/*
+ *  void vga_video_mem (uint32_t base)
+ *  DESCRIPTION: move the video memory of every terminal to base
+ *  INPUTS:     base -- VIDEO_MEM_ADDR or text_shadow, with the same layout
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: a running program with vidmap is mapped to its new video memory
+ */
+static void vga_video_mem(uint32_t base){
+    int32_t i;      // loop index
+    for (i = 0; i < TERMINAL_NUM; ++i){
+        terminal_array[i].video_mem_buf = base + i * VIDEO_REGION;
+    }
+    if (running_process != -1 && get_PCB(running_process)->flag_vidmem == 1){
+        vidmem_paging(running_terminal->video_mem_buf);
+    }
+}
+
+
+
+/*
+ *  void vga_graphics_mode ()
+ *  DESCRIPTION: save the text mode and set mode 13h, the frame buffer is shown at once
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: called with interrupts off
+ */
+static void vga_graphics_mode(){
+    int32_t i;      // loop index
+    if (vga_graphics) return;
+
+    vga_read_regs(text_regs);
+    vga_font(0);
+    memcpy(text_shadow, (void*)VIDEO_MEM_ADDR, sizeof(text_shadow));
+    vga_video_mem((uint32_t)text_shadow);
+    outb(0, VGA_DAC_READ_INDEX);
+    for (i = 0; i < sizeof(dac_save); ++i) dac_save[i] = inb(VGA_DAC_DATA);
+
+    vga_write_regs(mode13h_regs);
+    // RRRGGGBB, the DAC takes 6 bits a color
+    outb(0, VGA_DAC_WRITE_INDEX);
+    for (i = 0; i < 256; ++i){
+        outb(((i >> 5) & 0x7) * 63 / 7, VGA_DAC_DATA);
+        outb(((i >> 2) & 0x7) * 63 / 7, VGA_DAC_DATA);
+        outb((i & 0x3) * 63 / 3, VGA_DAC_DATA);
+    }
+    vga_graphics = 1;
+    memcpy((void*)FB_MEM_ADDR, fb_back, FB_SIZE);
+}
+
+
+
+/*
+ *  void vga_text_mode ()
+ *  DESCRIPTION: go back to the text mode saved by vga_graphics_mode
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: called with interrupts off
+ */
+static void vga_text_mode(){
+    int32_t i;      // loop index
+    if (!vga_graphics) return;
+
+    vga_write_regs(text_regs);
+    vga_font(1);
+    outb(0, VGA_DAC_WRITE_INDEX);
+    for (i = 0; i < sizeof(dac_save); ++i) outb(dac_save[i], VGA_DAC_DATA);
+    vga_graphics = 0;
+
+    memcpy((void*)VIDEO_MEM_ADDR, text_shadow, sizeof(text_shadow));
+    vga_video_mem(VIDEO_MEM_ADDR);
+    display_terminal->sb_view = 0;
+    set_display_start(DISPLAY_START(display_terminal));
+    switch_cursor(display_terminal->screen_x, display_terminal->screen_y);
+}
+
+
+
+/*
+ *  int32_t fb_claim ()
+ *  DESCRIPTION: give the frame buffer to the running process and map it at FB_START
+ *  INPUTS:     none
+ *  OUTPUTS:    mode 13h is set if the terminal of the process is shown
+ *  RETURN VALUE: 0 on success, -1 if another process has the frame buffer
+ */
+int32_t fb_claim(void){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (running_process == -1 || (fb_owner != -1 && fb_owner != running_process)){
+        restore_flags(flags);
+        return -1;
+    }
+    if (fb_owner == -1){
+        memset(fb_back, 0, sizeof(fb_back));
+        fb_owner = running_process;
+        fb_tid = running_terminal->tid;
+        get_PCB(running_process)->flag_fb = 1;
+    }
+    fb_paging((uint32_t)fb_back);
+    if (display_terminal->tid == fb_tid) vga_graphics_mode();
+    restore_flags(flags);
+    return 0;
+}
+
+
+
+/*
+ *  int32_t fb_present ()
+ *  DESCRIPTION: copy the frame buffer to the screen in the next vertical retrace
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 0 on success, -1 if the running process does not have the frame buffer
+ *  SIDE EFFECTS: nothing is copied while another terminal is shown
+ */
+int32_t fb_present(void){
+    uint32_t flags;
+    int32_t i;      // loop index
+    if (running_process == -1 || running_process != fb_owner) return -1;
+    if (!vga_graphics) return 0;
+
+    // wait for the end of a retrace which is running, then for the start of the next one
+    for (i = 0; i < VGA_RETRACE_SPIN && (inb(VGA_INSTAT_READ) & VGA_RETRACE); ++i);
+    for (i = 0; i < VGA_RETRACE_SPIN && !(inb(VGA_INSTAT_READ) & VGA_RETRACE); ++i);
+
+    cli_and_save(flags);
+    if (vga_graphics) memcpy((void*)FB_MEM_ADDR, fb_back, FB_SIZE);
+    restore_flags(flags);
+    return 0;
+}
+
+
+
+/*
+ *  void fb_release ()
+ *  DESCRIPTION: take the frame buffer back from its owner, which is exiting
+ *  INPUTS:     none
+ *  OUTPUTS:    the text mode is back if it was in mode 13h
+ *  RETURN VALUE: none
+ */
+void fb_release(void){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (fb_owner != -1){
+        get_PCB(fb_owner)->flag_fb = 0;
+        fb_owner = -1;
+        fb_tid = -1;
+        fb_paging(0);
+        vga_text_mode();
+    }
+    restore_flags(flags);
+}
+
+
+
+/*
+ *  void fb_map (int32_t owner)
+ *  DESCRIPTION: map the frame buffer for the next process, or unmap it
+ *  INPUTS:     owner -- flag_fb of the next process
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+void fb_map(int32_t owner){
+    fb_paging(owner ? (uint32_t)fb_back : 0);
+}
+
+
+
+/*
+ *  void vga_terminal_switch (int32_t tid)
+ *  DESCRIPTION: the display terminal is now tid, set the mode it needs
+ *  INPUTS:     tid -- the new display terminal
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  SIDE EFFECTS: called with interrupts off
+ */
+void vga_terminal_switch(int32_t tid){
+    if (tid == fb_tid) vga_graphics_mode();
+    else vga_text_mode();
+}
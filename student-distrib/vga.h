@@ -0,0 +1,49 @@
+#ifndef VGA_H
+#define VGA_H
+
+#include "types.h"
+
+
+
+#define FB_WIDTH            320         // mode 13h, one byte a pixel
+#define FB_HEIGHT           200
+#define FB_SIZE             (FB_WIDTH * FB_HEIGHT)
+
+// VGA ports
+#define VGA_AC_INDEX        0x3C0       // attribute controller, also its data port for writes
+#define VGA_AC_READ         0x3C1
+#define VGA_MISC_WRITE      0x3C2
+#define VGA_SEQ_INDEX       0x3C4
+#define VGA_SEQ_DATA        0x3C5
+#define VGA_DAC_READ_INDEX  0x3C7
+#define VGA_DAC_WRITE_INDEX 0x3C8
+#define VGA_DAC_DATA        0x3C9
+#define VGA_MISC_READ       0x3CC
+#define VGA_GC_INDEX        0x3CE
+#define VGA_GC_DATA         0x3CF
+#define VGA_CRTC_INDEX      0x3D4
+#define VGA_CRTC_DATA       0x3D5
+#define VGA_INSTAT_READ     0x3DA       // input status 1, also resets the index/data flip-flop of the AC
+
+// the registers of a mode in the order they are written: misc, sequencer, CRTC, GC, AC
+#define VGA_NUM_SEQ         5
+#define VGA_NUM_CRTC        25
+#define VGA_NUM_GC          9
+#define VGA_NUM_AC          21
+#define VGA_NUM_REGS        (1 + VGA_NUM_SEQ + VGA_NUM_CRTC + VGA_NUM_GC + VGA_NUM_AC)
+
+#define VGA_RETRACE         0x08        // input status 1, the vertical retrace is running
+#define VGA_RETRACE_SPIN    0x100000    // give up waiting for the retrace after this many reads
+#define VGA_FONT_SIZE       (256 * 32)  // plane 2 holds 32 bytes a character
+
+
+
+extern int32_t vga_graphics;
+
+int32_t fb_claim(void);
+int32_t fb_present(void);
+void fb_release(void);
+void fb_map(int32_t owner);
+void vga_terminal_switch(int32_t tid);
+
+#endif
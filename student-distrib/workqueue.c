@@ -0,0 +1,131 @@
+#include "workqueue.h"
+#include "kthread.h"
+#include "library/lib.h"
+
+
+/*
+ *  The deferred work queue (bottom halves).
+ *  Interrupt handlers only acknowledge the hardware and call queue_work(),
+ *  the real work is done later by the worker kernel thread with interrupts
+ *  enabled. The ring is single-producer (producers run with interrupts off)
+ *  and single-consumer (the worker), so head and tail need no lock.
+ */
+static work_t work_ring[WORK_QUEUE_SIZE];
+static volatile uint32_t work_head = 0;     // next free slot, only written by producers
+static volatile uint32_t work_tail = 0;     // next work to run, only written by the consumer
+extern int32_t shells_booted;
+
+
+
+/*
+ *  void worker_main (void* arg)
+ *  DESCRIPTION: body of the worker kernel thread
+ *  INPUTS:     unused
+ *  OUTPUTS:    runs all the queued work, then yields
+ *  RETURN VALUE: never returns
+ */
+static void worker_main(void* arg){
+    while (1){
+        run_work();
+        kthread_yield();
+    }
+}
+
+
+
+/*
+ *  void workqueue_init ()
+ *  DESCRIPTION: create the worker kernel thread
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ */
+void workqueue_init(){
+    work_head = 0;
+    work_tail = 0;
+    kthread_create(worker_main, NULL, work_pending);
+}
+
+
+
+/*
+ *  int32_t queue_work (void (*func)(void*), void* arg)
+ *  DESCRIPTION: append a piece of work to the queue, safe to call from interrupt handlers
+ *  INPUTS:     func -- the function to run later
+ *              arg -- its argument
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 0 on success, -1 if the queue is full
+ */
+int32_t queue_work(void (*func)(void*), void* arg){
+    uint32_t flags;
+    if (func == NULL) return -1;
+
+    cli_and_save(flags);
+    if (work_head - work_tail >= WORK_QUEUE_SIZE){   // full, drop the work
+        restore_flags(flags);
+        return -1;
+    }
+    work_ring[work_head & (WORK_QUEUE_SIZE - 1)].func = func;
+    work_ring[work_head & (WORK_QUEUE_SIZE - 1)].arg = arg;
+    work_head++;                                    // publish the entry
+    restore_flags(flags);
+    return 0;
+}
+
+
+
+/*
+ *  int32_t work_pending ()
+ *  DESCRIPTION: check if there is any queued work
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: 1 if the queue is not empty, 0 otherwise
+ */
+int32_t work_pending(){
+    return work_head != work_tail;
+}
+
+
+
+/*
+ *  void run_work ()
+ *  DESCRIPTION: run every queued work item, in order
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  NOTES:      the work itself runs with interrupts enabled
+ */
+void run_work(){
+    while (work_head != work_tail){
+        work_t work = work_ring[work_tail & (WORK_QUEUE_SIZE - 1)];
+        work_tail++;                                // the slot can be reused now
+        sti();
+        work.func(work.arg);
+    }
+}
+
+
+
+/*
+ *  void work_kick ()
+ *  DESCRIPTION: called at the end of an interrupt handler after queueing work;
+ *               before the scheduler is running nobody would pick up the worker
+ *               thread, so the queue is drained right here instead
+ *  INPUTS:     none
+ *  OUTPUTS:    none
+ *  RETURN VALUE: none
+ *  NOTES:      the work runs with interrupts on, an interrupt arriving meanwhile
+ *              leaves its work to the drain further down the stack, which is the
+ *              only consumer. Returns with interrupts off
+ */
+void work_kick(){
+    static int32_t draining = 0;    // run_work is active further down the stack
+    if (shells_booted == 0 && draining == 0){
+        draining = 1;
+        do {
+            run_work();
+            cli();
+        } while (work_pending());
+        draining = 0;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "types.h"
+
+
+
+#define WORK_QUEUE_SIZE     32      // must be a power of 2
+
+
+
+// a piece of deferred work, func(arg) runs later with interrupts enabled
+typedef struct work{
+    void (*func)(void*);
+    void* arg;
+} work_t;
+
+
+
+void workqueue_init();
+int32_t queue_work(void (*func)(void*), void* arg);
+int32_t work_pending();
+void run_work();
+void work_kick();
+
+#endif
@@ -49,6 +49,9 @@ DO_CALL(ece391_halt,1 /* SYS_HALT */);
 DO_CALL(__ece391_read,3 /* SYS_READ */);
 DO_CALL(__ece391_write,4 /* SYS_WRITE */);
 DO_CALL(__ece391_close,6 /* SYS_CLOSE */);
+/* struct ece391_iovec has the same layout as the Linux one */
+DO_CALL(ece391_readv,145 /* Linux readv */);
+DO_CALL(ece391_writev,146 /* Linux writev */);
 
 /* Call the main() function, then halt with its return value. */
 
@@ -225,3 +228,33 @@ ece391_close (int32_t fd)
     return 0;
 }
 
+
+int32_t 
+ece391_brk (void* addr)
+{
+    return (0 == brk (addr)) ? 0 : -1;
+}
+
+void* 
+ece391_sbrk (int32_t increment)
+{
+    return sbrk (increment);
+}
+
+int32_t 
+ece391_vidmap_fb (uint8_t** fb_start)
+{
+    return -1;
+}
+
+int32_t 
+ece391_fb_flip (void)
+{
+    return -1;
+}
+
+int32_t 
+ece391_tty_mode (int32_t mode)
+{
+    return (mode == 0) ? 0 : -1;
+}
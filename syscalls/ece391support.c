@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <stdint.h>
 
 #include "ece391support.h"
@@ -102,3 +103,108 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+/*
+ * A small allocator on top of sbrk.  Blocks of up to MALLOC_MAX_SMALL bytes
+ * are rounded up to a power of two and kept in one free list per size, so
+ * both malloc and free are O(1).  Bigger blocks are rounded up to
+ * MALLOC_ALIGN and reused first fit.  Memory is taken from the kernel
+ * MALLOC_GROW bytes at a time and never given back.
+ */
+#define MALLOC_ALIGN        16
+#define MALLOC_HEADER       MALLOC_ALIGN    /* keeps the data aligned */
+#define MALLOC_MIN_SMALL    16
+#define MALLOC_CLASSES      9               /* 16, 32, ..., 4096 bytes */
+#define MALLOC_MAX_SMALL    (MALLOC_MIN_SMALL << (MALLOC_CLASSES - 1))
+#define MALLOC_GROW         0x4000
+#define MALLOC_MAGIC        0x4D414C43
+
+typedef struct block {
+    uint32_t size;          /* the whole block, the header included */
+    uint32_t magic;         /* MALLOC_MAGIC while allocated */
+    struct block* next;     /* the next free block, only valid while free */
+} block_t;
+
+static block_t* free_small[MALLOC_CLASSES];
+static block_t* free_large = NULL;
+static uint8_t* arena_cur = NULL;       /* unused memory from the last sbrk */
+static uint8_t* arena_end = NULL;
+
+/* Cut size bytes from the arena, asking the kernel for more if needed */
+static block_t* arena_alloc(uint32_t size)
+{
+    block_t* block;
+
+    if ((uint32_t)(arena_end - arena_cur) < size) {
+        uint32_t grow = (size + MALLOC_GROW - 1) & ~(MALLOC_GROW - 1);
+        uint8_t* mem = ece391_sbrk (grow);
+        if ((void*)-1 == mem)
+            return NULL;
+        /* the heap is contiguous, so the rest of the arena stays usable */
+        if (mem != arena_end)
+            arena_cur = (uint8_t*)(((uint32_t)mem + MALLOC_ALIGN - 1) & ~(MALLOC_ALIGN - 1));
+        arena_end = mem + grow;
+        if ((uint32_t)(arena_end - arena_cur) < size)
+            return NULL;
+    }
+    block = (block_t*)arena_cur;
+    arena_cur += size;
+    block->size = size;
+    return block;
+}
+
+void* ece391_malloc(uint32_t size)
+{
+    block_t* block;
+    block_t** link;
+    int32_t class;
+
+    if (0 == size || size > 0x400000)
+        return NULL;
+    size += MALLOC_HEADER;
+
+    if (size <= MALLOC_MAX_SMALL) {
+        for (class = 0; (MALLOC_MIN_SMALL << class) < size; class++);
+        block = free_small[class];
+        if (NULL != block)
+            free_small[class] = block->next;
+        else
+            block = arena_alloc (MALLOC_MIN_SMALL << class);
+    } else {
+        size = (size + MALLOC_ALIGN - 1) & ~(MALLOC_ALIGN - 1);
+        for (link = &free_large; NULL != *link && (*link)->size < size;
+             link = &(*link)->next);
+        block = *link;
+        if (NULL != block)
+            *link = block->next;
+        else
+            block = arena_alloc (size);
+    }
+
+    if (NULL == block)
+        return NULL;
+    block->magic = MALLOC_MAGIC;
+    return (uint8_t*)block + MALLOC_HEADER;
+}
+
+void ece391_free(void* ptr)
+{
+    block_t* block;
+    int32_t class;
+
+    if (NULL == ptr)
+        return;
+    block = (block_t*)((uint8_t*)ptr - MALLOC_HEADER);
+    if (MALLOC_MAGIC != block->magic)
+        return;     /* not from malloc, or freed twice */
+    block->magic = 0;
+
+    if (block->size <= MALLOC_MAX_SMALL) {
+        for (class = 0; (MALLOC_MIN_SMALL << class) < block->size; class++);
+        block->next = free_small[class];
+        free_small[class] = block;
+    } else {
+        block->next = free_large;
+        free_large = block;
+    }
+}
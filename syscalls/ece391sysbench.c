@@ -0,0 +1,50 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 64
+#define ROUNDS  100000
+
+/* read the time stamp counter, only the low 32 bits are needed here */
+static inline uint32_t rdtsc_low ()
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+static void print_result (const char* name, uint32_t cycles)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (cycles / ROUNDS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+}
+
+/*
+ * Round-trip cost of a system call that does no real work: close on an
+ * invalid descriptor is rejected right after the dispatch, so the time
+ * measured is almost all entry and exit overhead.
+ */
+int main ()
+{
+    uint32_t i, start, slow, fast;
+
+    start = rdtsc_low ();
+    for (i = 0; i < ROUNDS; i++)
+        (void)ece391_close (-1);
+    slow = rdtsc_low () - start;
+
+    start = rdtsc_low ();
+    for (i = 0; i < ROUNDS; i++)
+        (void)ece391_fast_close (-1);
+    fast = rdtsc_low () - start;
+
+    print_result ("int $0x80:        ", slow);
+    print_result ("sysenter/sysexit: ", fast);
+
+    return 0;
+}
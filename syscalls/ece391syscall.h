@@ -5,6 +5,12 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* One buffer for readv/writev, at most 16 buffers per call. */
+struct ece391_iovec {
+    void* iov_base;
+    int32_t iov_len;
+};
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +27,43 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_readv (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+
+/*
+ * The heap starts right behind the program and may grow up to the stack
+ * reserve at the top of the 4 MB user page.  sbrk returns the old end of
+ * the heap, i.e. the start of the new memory, or (void*)-1.
+ */
+extern int32_t ece391_brk (void* addr);
+extern void* ece391_sbrk (int32_t increment);
+
+/*
+ * vidmap_fb switches to 320x200 graphics with 256 colors (RRRGGGBB) and
+ * maps a frame buffer of one byte a pixel.  Draw into it, then call
+ * fb_flip, e.g. after every RTC read; the frame buffer is copied to the
+ * screen in the next vertical retrace.  Only one program may have it, the
+ * text mode comes back when that program halts.
+ */
+extern int32_t ece391_vidmap_fb (uint8_t** fb_start);
+extern int32_t ece391_fb_flip (void);
+
+/*
+ * tty_mode chooses how read (0, ...) takes the keys: TTY_CANON returns a
+ * whole line once Enter is pressed, TTY_RAW returns every key as soon as
+ * it is typed, without echo.  Returns the old mode.  A program starts in
+ * TTY_CANON and its mode ends with it.
+ */
+#define TTY_CANON 0
+#define TTY_RAW   1
+extern int32_t ece391_tty_mode (int32_t mode);
+
+/* Same calls through SYSENTER/SYSEXIT, lower overhead per call. */
+extern int32_t ece391_fast_read (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_fast_write (int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t ece391_fast_open (const uint8_t* filename);
+extern int32_t ece391_fast_close (int32_t fd);
+extern int32_t ece391_fast_getargs (uint8_t* buf, int32_t nbytes);
 
 enum signums {
 	DIV_ZERO = 0,
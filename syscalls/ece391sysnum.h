@@ -11,5 +11,12 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_READV   11
+#define SYS_WRITEV  12
+#define SYS_BRK     13
+#define SYS_SBRK    14
+#define SYS_VIDMAP_FB  15
+#define SYS_FB_FLIP 16
+#define SYS_TTY_MODE  17
 
 #endif /* ECE391SYSNUM_H */